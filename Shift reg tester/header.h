@@ -1,4 +1,76 @@
 
+// Shift register tester: 74HC595 chain speed characterization
+//
+// Shifts known patterns through the chain and reads them back from QH' of
+// the last chip, with the shift clock paced by Timer2 (polled, reload
+// RCAP2H/RCAP2L). The reload is swept from SWEEP_TICKS_MAX down to 1 tick
+// per SRCLK half-period, then one unpaced pass runs as fast as the loop
+// can go (the Tx SRCLK_HZ = 0 case). Every step and the fastest rate with
+// no error at that step or any slower one are reported on the UART
+// (9600 8N1). A sweep starts at power-up and on every button press.
+//
+// Wiring: same pins as the Tx board (Stage1_TRANSMITTER(Tx)_MCU/header.h)
+// plus the loopback, so the result applies to that board revision:
+//   P2.0 -> SER (pin 14 of the first chip)
+//   P2.1 -> SRCLK (pin 11, all chips)
+//   P2.2 -> RCLK (pin 12, all chips)
+//   P2.7 <- QH' (pin 9 of the last chip), unused by the Tx board (P2.3
+//           strobe, P2.4 lane B SER, P2.4/P2.5 split SRCLKs)
+//   P3.2 (INT0) push button to GND
+//   P3.0/P3.1 UART to the host
+
+#define CHAIN_CHIPS     2       // 74HC595s in the chain (R = 4: 15 lines + aux)
+#define CHAIN_BITS      (8 * CHAIN_CHIPS)
+
+#if (CHAIN_CHIPS < 1) || (CHAIN_CHIPS > 4)
+#error "CHAIN_CHIPS must be 1..4"
+#endif
+
+// Timer clock: the ADuC841 core is single-cycle and Timers 0 and 2 count
+// core cycles, ~90.4 ns per count at 11.0592 MHz. Keep CORE_CLK_HZ equal to
+// the Tx Core Clock block (Stage1_TRANSMITTER(Tx)_MCU/header.h).
+#define CORE_CLK_HZ     11059200UL
+#define TIMER_CLK_HZ    CORE_CLK_HZ
+
+// Sweep: Timer2 counts per SRCLK half-period, from SWEEP_TICKS_MAX down,
+// about 12% faster per step. Each step shifts every pattern SWEEP_REPEATS
+// times. The reported rate is measured with Timer0 over one word (two
+// half-periods per bit), so steps where the loop is slower than the
+// reload show the real SRCLK rate, not the nominal one.
+#define SWEEP_TICKS_MAX 256
+#define SWEEP_REPEATS   2
+
+#if (SWEEP_TICKS_MAX < 1) || (4UL * CHAIN_BITS * SWEEP_TICKS_MAX > 60000UL)
+#error "SWEEP_TICKS_MAX must be 1..60000 / (4 * CHAIN_BITS): one word must fit in Timer0"
+#endif
+
+#if (CHAIN_CHIPS <= 2)
+typedef unsigned int chain_t;
+#else
+typedef unsigned long chain_t;
+#endif
+
+#define CHAIN_MASK      ((chain_t)(0xFFFFFFFFUL >> (32 - CHAIN_BITS)))
+#define CHAIN_MSB       ((chain_t)(1UL << (CHAIN_BITS - 1)))
+
+sbit SR_DATA  = P2^0;   // 74HC595 SER
+sbit SR_CLK   = P2^1;   // 74HC595 SRCLK, rising edge
+sbit SR_LATCH = P2^2;   // 74HC595 RCLK, rising edge
+sbit SR_QH    = P2^7;   // Loopback from QH' of the last chip (input)
+
+extern volatile bit start_flag;
+
 void Init_Timer2(void);
 void Init_Button(void);
+void Init_UART(void);
+void Init_Timer0(void);
+void Stopwatch_Start(void);
+unsigned int Stopwatch_Stop(void);
+void Timer2_Set(unsigned int ticks);
+void Timer2_Restart(void);
+void Timer2_Stop(void);
+void uart_putc(unsigned char c);
+void uart_puts(char *s);
+void uart_put_dec(unsigned long value, unsigned char width);
+void uart_put_hex(unsigned int value);
 
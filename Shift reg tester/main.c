@@ -1,12 +1,194 @@
 #include <aduc841.h>
 #include "header.h"
 
-void main(void) 
-	{
+// Fixed patterns, then a walking 1, a walking 0 and PATTERN_RANDOM words
+// from a 16-bit LFSR (same sequence every step)
+#define PATTERN_FIXED   4
+#define PATTERN_RANDOM  8
+#define PATTERN_COUNT   (PATTERN_FIXED + 2 * CHAIN_BITS + PATTERN_RANDOM)
+
+static unsigned long code fixed_pattern[PATTERN_FIXED] =
+{
+    0x00000000UL, 0xFFFFFFFFUL, 0xAAAAAAAAUL, 0x55555555UL
+};
+
+static bit paced;               // SRCLK half-periods wait for Timer2
+static unsigned int lfsr;
+
+// End of one SRCLK half-period: next Timer2 overflow when paced
+#define HALF_PERIOD()   if (paced) { while (!TF2); TF2 = 0; }
+
+static unsigned int lfsr_next(void) {
+    lfsr = (lfsr >> 1) ^ ((lfsr & 1) ? 0xB400 : 0);
+    return lfsr;
+}
+
+static chain_t pattern(unsigned char index) {
+    if (index < PATTERN_FIXED) {
+        return (chain_t)fixed_pattern[index] & CHAIN_MASK;
+    }
+    index -= PATTERN_FIXED;
+    if (index < CHAIN_BITS) {
+        return (chain_t)1 << index;                 // Walking 1
+    }
+    index -= CHAIN_BITS;
+    if (index < CHAIN_BITS) {
+        return CHAIN_MASK ^ ((chain_t)1 << index);  // Walking 0
+    }
+#if (CHAIN_BITS > 16)
+    return (((chain_t)lfsr_next() << 16) | lfsr_next()) & CHAIN_MASK;
+#else
+    return (chain_t)lfsr_next() & CHAIN_MASK;
+#endif
+}
+
+// shift_word
+// Shifts `out` into the chain MSB first (same order as the Tx shift_load)
+// and returns what QH' of the last chip showed before each rising edge:
+// the word that was in the chain before.
+// SER changes while SRCLK is low, QH' is sampled at the end of the low
+// half, one SRCLK period after the edge that moved it.
+static chain_t shift_word(chain_t out) {
+    chain_t in = 0;
+    unsigned char i;
+
+    if (paced) {
+        Timer2_Restart();   // Full first half-period after the gap since the last word
+    }
+    for (i = 0; i < CHAIN_BITS; i++) {
+        SR_DATA = (out & CHAIN_MSB) ? 1 : 0;
+        HALF_PERIOD();
+        in = (in << 1) | SR_QH;
+        SR_CLK = 1;
+        HALF_PERIOD();
+        SR_CLK = 0;
+        out <<= 1;
+    }
+
+    return in;
+}
+
+static unsigned char bit_errors(chain_t diff) {
+    unsigned char count = 0;
+
+    while (diff) {
+        diff &= diff - 1;
+        count++;
+    }
+
+    return count;
+}
+
+// test_step
+// One sweep step: `ticks` Timer2 counts per half-period, 0 = unpaced.
+// Every pattern goes in, then its complement while the pattern is read
+// back; RCLK latches the complement onto the outputs. The SRCLK rate is
+// measured over one word. Returns the number of wrong bits.
+static unsigned long test_step(unsigned int ticks, unsigned long *hz) {
+    unsigned long errors = 0;
+    unsigned int counts;
+    unsigned char repeat;
+    unsigned char i;
+    chain_t p;
+
+    paced = (ticks != 0);
+    if (paced) {
+        Timer2_Set(ticks);
+    }
+
+    Stopwatch_Start();
+    shift_word(0);
+    counts = Stopwatch_Stop();
+    *hz = counts ? (TIMER_CLK_HZ * CHAIN_BITS + counts / 2) / counts : 0;
+
+    for (repeat = 0; repeat < SWEEP_REPEATS; repeat++) {
+        lfsr = 0xACE1;
+        for (i = 0; i < PATTERN_COUNT; i++) {
+            p = pattern(i);
+            shift_word(p);
+            errors += bit_errors(shift_word(p ^ CHAIN_MASK) ^ p);
+            SR_LATCH = 1;
+            SR_LATCH = 0;
+        }
+    }
+
+    Timer2_Stop();
+
+    return errors;
+}
+
+// run_sweep
+// Steps the reload from SWEEP_TICKS_MAX down to 1, then unpaced, and
+// prints one line per step. The result is the fastest measured rate with
+// no error at that step or any slower one.
+static void run_sweep(void) {
+    unsigned int ticks;
+    unsigned long errors;
+    unsigned long hz;
+    unsigned long best_hz = 0;
+    unsigned int best_ticks = 0;
+    bit clean = 1;
+
+    uart_puts("\r\n74HC595 chain test: ");
+    uart_put_dec(CHAIN_CHIPS, 0);
+    uart_puts(" chips, ");
+    uart_put_dec(PATTERN_COUNT, 0);
+    uart_puts(" patterns x ");
+    uart_put_dec(SWEEP_REPEATS, 0);
+    uart_puts("\r\n ticks reload  SRCLK Hz  errors\r\n");
+
+    for (ticks = SWEEP_TICKS_MAX; ; ticks -= (ticks >> 3) + 1) {
+        errors = test_step(ticks, &hz);
+
+        if (ticks) {
+            uart_put_dec(ticks, 6);
+            uart_puts("   ");
+            uart_put_hex((unsigned int)(65536UL - ticks));
+        } else {
+            uart_puts("  fast   ----");
+        }
+        uart_put_dec(hz, 10);
+        uart_put_dec(errors, 8);
+        uart_puts("\r\n");
+
+        if (errors) {
+            clean = 0;
+        } else if (clean && hz > best_hz) {
+            best_hz = hz;
+            best_ticks = ticks;
+        }
+
+        if (ticks == 0) {
+            break;
+        }
+    }
+
+    if (best_hz == 0) {
+        uart_puts("No error-free step: check QH' -> P2.7 and the chain\r\n");
+        return;
+    }
+
+    uart_puts("Max error-free SRCLK: ");
+    uart_put_dec(best_hz, 0);
+    uart_puts(" Hz (");
+    if (best_ticks) {
+        uart_put_dec(best_ticks, 0);
+        uart_puts(" ticks)\r\n");
+    } else {
+        uart_puts("unpaced)\r\n");
+    }
+}
+
+void main(void) {
+    Init_UART();
+    Init_Timer0();
     Init_Timer2();
     Init_Button();
-    
-    while(1) 
-		{	
-		}
-}
\ No newline at end of file
+
+    while (1) {
+        if (start_flag) {
+            start_flag = 0;
+            run_sweep();
+        }
+    }
+}
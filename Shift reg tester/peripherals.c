@@ -1,54 +1,129 @@
 #include <aduc841.h>
 #include "header.h"
 
-sbit SR_CLK   = P3^0;   
-sbit SR_DATA  = P3^1;   
-sbit BUTTON   = P3^2;   
-sbit SR_LATCH = P3^3;   
-
-volatile unsigned int counter = 0; 
+volatile bit start_flag = 1;    // Power-up sweep
 
+// Timer2: 16-bit auto-reload, polled by the shift loop (no interrupt)
 void Init_Timer2(void) {
     SR_CLK = 0;
-    SR_DATA = 1;  // Constant '1' input
-    SR_LATCH = 0; 
-	
-    // 2. Configure Timer 2
-    // T2CON = 0x00: 16-bit Auto-Reload mode
-    T2CON = 0x00;     
-    RCAP2H = 0xFC; 
-    RCAP2L = 0x66;     
-    ET2 = 1;  
-    EA = 1;   
-    TR2 = 0;  
+    SR_DATA = 0;
+    SR_LATCH = 0;
+    SR_QH = 1;      // Quasi-bidirectional pin: write 1 to read it
+
+    T2CON = 0x00;   // 16-bit Auto-Reload mode, stopped
+    ET2 = 0;
+}
+
+// Restart Timer2 with an overflow (TF2) every `ticks` counts
+void Timer2_Set(unsigned int ticks) {
+    unsigned int reload = (unsigned int)(65536UL - ticks);
+
+    TR2 = 0;
+    RCAP2H = reload >> 8;
+    RCAP2L = reload & 0xFF;
+    TH2 = RCAP2H;
+    TL2 = RCAP2L;
+    TF2 = 0;
+    TR2 = 1;
 }
 
-void Init_Button(void) {    
-    IT0 = 1; 
-    EX0 = 1; 
+// Start a new period from the reload value
+void Timer2_Restart(void) {
+    TR2 = 0;
+    TH2 = RCAP2H;
+    TL2 = RCAP2L;
+    TF2 = 0;
+    TR2 = 1;
 }
 
+void Timer2_Stop(void) {
+    TR2 = 0;
+    TF2 = 0;
+}
 
+// Timer0: 16-bit stopwatch (mode 1), same count rate as Timer2
+void Init_Timer0(void) {
+    TMOD &= 0xF0;
+    TMOD |= 0x01;
+    TR0 = 0;
+    ET0 = 0;
+}
 
-void External0_ISR(void) interrupt 0 {
-    counter = 0;    
-    TH2 = 0xFC;
-    TL2 = 0x66;    
-    TR2 = 1; 
-}
-
-void Timer2_ISR(void) interrupt 5 {
-    TF2 = 0; 
-    
-    if(counter < 2) {
-        // Toggle Clock and Latch
-        SR_CLK = ~SR_CLK; 
-        SR_LATCH = ~SR_LATCH;
-        counter++;
+void Stopwatch_Start(void) {
+    TH0 = 0;
+    TL0 = 0;
+    TF0 = 0;
+    TR0 = 1;
+}
+
+// Counts since Stopwatch_Start()
+unsigned int Stopwatch_Stop(void) {
+    TR0 = 0;
+    return ((unsigned int)TH0 << 8) | TL0;
+}
+
+void Init_Button(void) {
+    IT0 = 1;    // Falling edge
+    EX0 = 1;
+    EA = 1;
+}
+
+// UART 8N1 at 9600 baud from Timer3 (same T3CON/T3FD as the Tx BAUD_9600)
+void Init_UART(void) {
+    T3CON = 0x00;
+    T3FD = 0x08;
+    T3CON = 0x86;
+    SM0 = 0;
+    SM1 = 1;
+    REN = 0;    // Transmit only
+    TI = 0;
+    ES = 0;     // Polled: the report is sent between sweep steps
+}
+
+void uart_putc(unsigned char c) {
+    SBUF = c;
+    while (!TI);
+    TI = 0;
+}
+
+void uart_puts(char *s) {
+    while (*s) {
+        uart_putc(*s++);
+    }
+}
+
+// Decimal, right-aligned in `width` characters
+void uart_put_dec(unsigned long value, unsigned char width) {
+    unsigned char digits[10];
+    unsigned char i = 0;
+
+    do {
+        digits[i++] = '0' + (unsigned char)(value % 10);
+        value /= 10;
+    } while (value > 0);
+
+    while (width > i) {
+        uart_putc(' ');
+        width--;
     }
-    else {
-        TR2 = 0; 
-        SR_CLK = 0;
-        SR_LATCH = 0;
+    while (i > 0) {
+        uart_putc(digits[--i]);
     }
-}
\ No newline at end of file
+}
+
+// Four hex digits
+void uart_put_hex(unsigned int value) {
+    unsigned char i;
+    unsigned char nibble;
+
+    for (i = 0; i < 4; i++) {
+        nibble = (value >> 12) & 0x0F;
+        uart_putc(nibble < 10 ? '0' + nibble : 'A' + nibble - 10);
+        value <<= 4;
+    }
+}
+
+// Button: request a new sweep (the main loop runs it)
+void External0_ISR(void) interrupt 0 {
+    start_flag = 1;
+}
@@ -0,0 +1,82 @@
+/* File: sim.h
+ * Interface between the simulator driver (sim_main.c) and the glue units
+ * sim_tx.c / sim_rx.c.
+ *
+ * The Tx and Rx header.h files both define uint8_t/uint16_t, HAMMING_R and
+ * friends, so each glue unit includes only its own side; everything that
+ * crosses between them uses plain C types here. A bus state is passed as
+ * unsigned long (bit j = bus line j+1 on both sides). With two lanes a
+ * latched state holds lane A in bits 0..14 and lane B in bits 16..30.
+ * With the aux parity line, bit N of a latched state is that line.
+ */
+#ifndef SIM_H
+#define SIM_H
+
+/* One timed hot-path function: run() calls it iterations times on
+ * pregenerated inputs. Entry 0 of each table times the same loop around
+ * sim_bench_nop(); sim_main.c subtracts it from the other entries. */
+typedef struct
+{
+    const char *name;
+    void (*run)(unsigned long iterations);
+} sim_bench_t;
+
+/* sim_main.c */
+unsigned long sim_random(void);
+void sim_bench_nop(unsigned char value);
+extern void (*sim_latch_hook)(unsigned long state);
+
+/* sim_tx.c (Tx header.h) */
+unsigned char sim_tx_hamming_r(void);
+unsigned char sim_tx_lanes(void);
+unsigned char sim_tx_aux_parity(void);
+unsigned char sim_tx_frame_max(void);
+void sim_tx_reset(void);
+unsigned long sim_tx_encode(unsigned char symbol);
+void sim_tx_set_state(unsigned long state);
+unsigned long sim_tx_find_w(unsigned char s_target);
+unsigned long sim_tx_process(unsigned char symbol);
+unsigned char sim_tx_syndrome(unsigned long state);
+void sim_tx_send_frame(const unsigned char *data, unsigned char len);
+unsigned char sim_tx_send_truncated(const unsigned char *data, unsigned char len,
+                                    unsigned char sent);
+unsigned char sim_tx_resync(void);
+extern const sim_bench_t sim_tx_benches[];
+extern const unsigned char sim_tx_bench_count;
+
+/* sim_rx.c (Rx header.h) */
+unsigned char sim_rx_hamming_r(void);
+unsigned char sim_rx_lanes(void);
+unsigned char sim_rx_aux_parity(void);
+unsigned char sim_rx_aux_ok(unsigned long raw);
+unsigned long sim_rx_raw_from_lines(unsigned long lines);
+unsigned long sim_rx_lines_from_raw(unsigned long raw);
+void sim_rx_reset(unsigned long raw);
+unsigned char sim_rx_decode(unsigned long raw);
+unsigned char sim_rx_toggled(void);
+unsigned char sim_rx_marker(void);
+unsigned char sim_rx_decode_x(unsigned long lines);
+unsigned char sim_rx_decode_b(unsigned long lines);
+void sim_rx_port_script(const unsigned long *raw, const unsigned long *lines_b,
+                        unsigned int count);
+unsigned long sim_rx_read(unsigned long *lines_b, unsigned long *passes,
+                          unsigned char *error);
+unsigned char sim_rx_stable_reads(void);
+unsigned char sim_rx_stable_window(void);
+unsigned char sim_rx_aux_retries(void);
+extern const sim_bench_t sim_rx_benches[];
+extern const unsigned char sim_rx_bench_count;
+
+/* Benchmark loop: SIM_BENCH_BATCH calls of CALL(k) per pass, so the loop
+ * costs a fraction of a call and sub-ns functions (find_minimal_w,
+ * bus_lines_from_raw) stand out from it. iterations is a multiple of
+ * SIM_BENCH_BATCH (sim_main.c rounds it). */
+#define SIM_BENCH_BATCH     8
+#define SIM_BENCH_LOOP(i, iterations, CALL) \
+    for ((i) = 0; (i) < (iterations); (i) += SIM_BENCH_BATCH) \
+    { \
+        CALL((i));     CALL((i) + 1); CALL((i) + 2); CALL((i) + 3); \
+        CALL((i) + 4); CALL((i) + 5); CALL((i) + 6); CALL((i) + 7); \
+    }
+
+#endif
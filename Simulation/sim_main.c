@@ -0,0 +1,1082 @@
+/* File: sim_main.c
+ * Host simulator for the H1-type bus: Tx encoder -> bus -> Rx decoder.
+ *
+ * Links the unmodified firmware sources bus_encoder.c and tx_handler.c
+ * (Stage1_TRANSMITTER) and Rx_decoder.c and Rx_input.c (Stage2_RECEIVER)
+ * with the glue in sim_tx.c / sim_rx.c and the stub <aduc841.h>
+ * (SIM_PORT_REPLAY for Rx_input.c), and runs five passes:
+ *
+ * 1. Symbol round trip: random R-bit symbols through encode_nibble(). For
+ *    every symbol the Tx syndrome of the new bus state must equal it, at
+ *    most one line may toggle (none for a repeat), and the Rx decoder
+ *    (raw port word -> rx_decode_step(), and get_S_from_X()) must return
+ *    it, with rx_toggled_line naming the toggled column.
+ * 2. State sweep: every bus state x every symbol (R <= 4; R = 5 takes
+ *    SIM_SWEEP_STATES random states). find_minimal_w() must return a w of
+ *    weight 0 or 1 with H * w = S_old ^ S_new, process_nibble() must latch
+ *    x' = x ^ w with H * x' = S_new and at most one toggled line, and
+ *    get_S_from_X(x') must return S_new.
+ * 3. Byte round trip: random bytes sent as CTRL_BURST frames through
+ *    tx_handler(); every latched state is decoded by the Rx side and the
+ *    symbols are packed back into bytes, which must match the input.
+ *    With two lanes (TX_LANES / RX_LANES = 2) every latch carries a whole
+ *    byte: lane A is decoded as the high nibble, lane B as the low one.
+ *    With TX_RESYNC_ENABLE the frames have random lengths and CTRL_RESYNC
+ *    is sent between some of them: the Rx must see the preparation state
+ *    as RX_TOGGLE_SKIP and the all-zero state as RX_TOGGLE_RESYNC, and
+ *    drop less than one symbol of padding.
+ *    With the aux parity line (TX_AUX_PARITY / RX_AUX_PARITY) every latch
+ *    must have even parity over lines + aux line and pass the Rx check,
+ *    and the same state with any one line flipped must fail it.
+ *    Last, a CTRL_BURST frame with its final byte missing must time out
+ *    (TX_FRAME_TIMEOUT_MS) without a latch and leave rx_fifo empty, and
+ *    the next frame must be latched in full.
+ * 4. Stable-read filter: read_bus_raw() on scripted port values, runs of
+ *    1 .. RX_STABLE_READS + 1 equal passes of a bus state, the next one
+ *    (two lanes: only lane B changed) and a mix of both, with random bits
+ *    on the pins that carry no bus line. The passes it takes,
+ *    rx_read_error (RX_STABLE_WINDOW, aux parity retries) and the word it
+ *    returns (and rx_raw_b with two lanes) must match a reference model
+ *    of the filter.
+ * 5. Benchmarks: time per call of the hot-path functions on the host,
+ *    SIM_BENCH_BATCH calls per loop pass (sim.h), minus the empty-call
+ *    loop. Each of SIM_BENCH_REPEAT rounds times the empty call and every
+ *    function back to back; each time is the median over the rounds.
+ *    Then the host instructions per call, minus the empty call: each
+ *    function runs SIM_COUNT_CALLS times in a child single-stepped with
+ *    ptrace.
+ *    With -B the instruction counts are checked against a budget file
+ *    (bench_budget.txt, written by -W) whose R / lanes header must match
+ *    the build: a function more than -t percent over its budget fails the
+ *    run, and so does a count the host does not allow (no ptrace).
+ *
+ * The benchmark numbers are host nanoseconds, host (TSC) cycles and host
+ * instructions, not 8051 machine cycles: use them to compare two versions
+ * of the code. Absolute target timings come from TX_INSTRUMENT. The times
+ * follow the host load (a shared host can run 2x slower for seconds at a
+ * time), so the budget gates the instruction count, which only changes
+ * with the code, the compiler and its flags.
+ *
+ * USAGE:
+ *     make run | make test | make bench-check | make budget
+ *     build/h1_sim [-n symbols] [-b bench_iterations] [-s seed]
+ *                  [-B budget_file [-t percent]] [-W budget_file]
+ * Exit status 1 if any check fails or a function is over budget.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define SIM_HAVE_TSC    1
+#else
+#define SIM_HAVE_TSC    0
+#endif
+#if defined(__linux__)
+#include <signal.h>
+#include <unistd.h>
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+#define SIM_HAVE_PTRACE 1
+#else
+#define SIM_HAVE_PTRACE 0
+#endif
+
+#include "sim.h"
+
+#define SIM_DEFAULT_SYMBOLS     4000000UL
+#define SIM_DEFAULT_BENCH       50000UL
+#define SIM_BENCH_REPEAT        101     /* Rounds per function, median */
+#define SIM_MAX_REPORTED        8       /* Failures printed per pass */
+#define SIM_SWEEP_STATES        (1UL << 20)     /* Random states when 2^N is larger */
+#define SIM_STABLE_SCRIPTS      4000    /* Port scripts for read_bus_raw() */
+#define SIM_STABLE_ENTRIES      64      /* Passes per script, <= REPLAY_MAX */
+#define SIM_BUDGET_MAX          32      /* Entries in a budget file */
+#define SIM_BENCH_MAX           16      /* Entries per benchmark table */
+#define SIM_BUDGET_TOLERANCE    25.0    /* Default -t, percent */
+#define SIM_COUNT_CALLS         512     /* Calls single-stepped per instruction count */
+
+void (*sim_latch_hook)(unsigned long state) = 0;
+
+static unsigned long long rng_state = 0x9E3779B97F4A7C15ULL;
+
+/* xorshift64: reproducible inputs for a given seed */
+unsigned long sim_random(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    
+    return (unsigned long)(rng_state >> 16);
+}
+
+void sim_bench_nop(unsigned char value)
+{
+    (void)value;
+}
+
+static unsigned char hamming_r;
+static unsigned char lanes;
+static unsigned char aux_parity;
+static unsigned char hamming_n;
+static unsigned long failures;
+
+static void fail(const char *pass, unsigned long index, const char *what,
+                 unsigned long got, unsigned long expected)
+{
+    if (failures < SIM_MAX_REPORTED)
+    {
+        printf("  FAIL %s #%lu: %s = 0x%lX, expected 0x%lX\n",
+               pass, index, what, got, expected);
+    }
+    failures++;
+}
+
+static unsigned int popcount(unsigned long value)
+{
+    unsigned int count = 0;
+    
+    while (value)
+    {
+        value &= value - 1;
+        count++;
+    }
+    
+    return count;
+}
+
+/* --- Pass 1: symbol round trip --- */
+
+static void test_symbols(unsigned long count)
+{
+    unsigned long i;
+    unsigned long state;
+    unsigned long prev_state = 0;
+    unsigned long raw;
+    unsigned char symbol;
+    unsigned char prev_symbol = 0;
+    unsigned char mask = (unsigned char)((1 << hamming_r) - 1);
+    
+    sim_tx_reset();
+    sim_rx_reset(sim_rx_raw_from_lines(0));
+    
+    for (i = 0; i < count; i++)
+    {
+        symbol = (unsigned char)(sim_random() & mask);
+        state = sim_tx_encode(symbol);
+    
+        if (sim_tx_syndrome(state) != symbol)
+        {
+            fail("symbol", i, "Tx syndrome", sim_tx_syndrome(state), symbol);
+        }
+        if (popcount(state ^ prev_state) != (symbol != prev_symbol))
+        {
+            fail("symbol", i, "toggled lines", popcount(state ^ prev_state),
+                 symbol != prev_symbol);
+        }
+    
+        raw = sim_rx_raw_from_lines(state);
+        if (sim_rx_lines_from_raw(raw) != state)
+        {
+            fail("symbol", i, "Rx line word", sim_rx_lines_from_raw(raw), state);
+        }
+        if (sim_rx_decode(raw) != symbol)
+        {
+            fail("symbol", i, "rx_decode_step", sim_rx_decode(raw), symbol);
+        }
+        if (sim_rx_toggled() != (symbol ^ prev_symbol))
+        {
+            fail("symbol", i, "rx_toggled_line", sim_rx_toggled(), symbol ^ prev_symbol);
+        }
+        if (sim_rx_decode_x(state) != symbol)
+        {
+            fail("symbol", i, "get_S_from_X", sim_rx_decode_x(state), symbol);
+        }
+    
+        prev_state = state;
+        prev_symbol = symbol;
+    }
+}
+
+/* --- Pass 2: every bus state x every symbol --- */
+
+static unsigned long sweep_latched;
+
+static void sweep_latch(unsigned long state)
+{
+    sweep_latched = state;
+}
+
+static void test_sweep(void)
+{
+    unsigned long states;
+    unsigned long index;
+    unsigned long x;
+    unsigned long x_new;
+    unsigned long w;
+    unsigned long line_mask = (1UL << hamming_n) - 1;
+    unsigned char symbols = (unsigned char)(1 << hamming_r);
+    unsigned char symbol;
+    unsigned char s_old;
+    int all;
+    
+    all = (hamming_n < 32) && ((1UL << hamming_n) <= SIM_SWEEP_STATES);
+    states = all ? (1UL << hamming_n) : SIM_SWEEP_STATES;
+    printf("  %lu %s states x %u symbols\n", states, all ? "(all)" : "random", symbols);
+    
+    sim_tx_reset();
+    sim_latch_hook = sweep_latch;
+    
+    for (index = 0; index < states; index++)
+    {
+        x = all ? index : (sim_random() & line_mask);
+        s_old = sim_tx_syndrome(x);
+    
+        for (symbol = 0; symbol < symbols; symbol++)
+        {
+            w = sim_tx_find_w((unsigned char)(symbol ^ s_old));
+            if (popcount(w) != (symbol != s_old))
+            {
+                fail("sweep", x, "weight of w", popcount(w), symbol != s_old);
+            }
+            if (sim_tx_syndrome(w) != (symbol ^ s_old))
+            {
+                fail("sweep", x, "H * w", sim_tx_syndrome(w), symbol ^ s_old);
+            }
+    
+            sim_tx_set_state(x);
+            sweep_latched = ~0UL;
+            x_new = sim_tx_process(symbol);
+    
+            if (x_new != (x ^ w))
+            {
+                fail("sweep", x, "x'", x_new, x ^ w);
+            }
+            if (sim_tx_syndrome(x_new) != symbol)
+            {
+                fail("sweep", x, "H * x'", sim_tx_syndrome(x_new), symbol);
+            }
+            if (popcount(x ^ x_new) > 1)
+            {
+                fail("sweep", x, "toggled lines", popcount(x ^ x_new), 1);
+            }
+            if ((sweep_latched & line_mask) != x_new)
+            {
+                fail("sweep", x, "latched state", sweep_latched & line_mask, x_new);
+            }
+            if (sim_rx_decode_x(x_new) != symbol)
+            {
+                fail("sweep", x, "get_S_from_X", sim_rx_decode_x(x_new), symbol);
+            }
+        }
+    }
+    
+    sim_latch_hook = 0;
+}
+
+/* --- Pass 3: byte round trip through tx_handler() --- */
+
+static unsigned char *frame_out;
+static unsigned long frame_out_len;
+static unsigned long frame_acc;
+static unsigned char frame_bits;
+static unsigned long frame_latches;
+static unsigned long frame_prev_state;
+static unsigned long frame_markers;
+static unsigned long frame_pad_bits;
+
+/* Aux line: the latch must pass the Rx parity check, one glitch must not */
+static void frame_aux_check(unsigned long state)
+{
+    unsigned long glitch = 1UL << (sim_random() % (hamming_n + 1));
+    
+    if (popcount(state) & 1)
+    {
+        fail("frame", frame_latches, "lines + aux parity", popcount(state), 0);
+    }
+    if (!sim_rx_aux_ok(sim_rx_raw_from_lines(state)))
+    {
+        fail("frame", frame_latches, "Rx aux check", 0, 1);
+    }
+    if (sim_rx_aux_ok(sim_rx_raw_from_lines(state ^ glitch)))
+    {
+        fail("frame", frame_latches, "Rx aux check, glitched line", glitch, 0);
+    }
+}
+
+/* Latch hook: decode the state on the Rx side, repack MSB-first */
+static void frame_latch(unsigned long state)
+{
+    unsigned char symbol;
+    unsigned long diff;
+    
+    if (aux_parity)
+    {
+        frame_aux_check(state);
+        state &= (1UL << hamming_n) - 1;
+    }
+    diff = state ^ frame_prev_state;
+    frame_prev_state = state;
+    symbol = sim_rx_decode(sim_rx_raw_from_lines(state & 0xFFFF));
+    
+    /* Resync markers carry no data and may change several lines */
+    if (sim_rx_marker())
+    {
+        frame_markers++;
+        if (sim_rx_marker() == 2)
+        {
+            if (frame_bits >= hamming_r)
+            {
+                fail("frame", frame_latches, "bits dropped at resync",
+                     frame_bits, hamming_r - 1);
+            }
+            frame_pad_bits += frame_bits;
+            frame_acc = 0;
+            frame_bits = 0;
+        }
+        return;
+    }
+    frame_latches++;
+    
+    if (lanes == 2)
+    {
+        /* Each lane is its own H1 bus: at most one line per lane */
+        if (popcount(diff & 0xFFFF) > 1 || popcount(diff >> 16) > 1)
+        {
+            fail("frame", frame_latches, "toggled lines per lane",
+                 popcount(diff), 2);
+        }
+        frame_out[frame_out_len++] = (unsigned char)((symbol << 4) |
+                                                     sim_rx_decode_b(state >> 16));
+        return;
+    }
+    
+    if (popcount(diff) > 1)
+    {
+        fail("frame", frame_latches, "toggled lines", popcount(diff), 1);
+    }
+    
+    frame_acc = (frame_acc << hamming_r) | symbol;
+    frame_bits += hamming_r;
+    if (frame_bits >= 8)
+    {
+        frame_bits -= 8;
+        frame_out[frame_out_len++] = (unsigned char)(frame_acc >> frame_bits);
+        frame_acc &= (1UL << frame_bits) - 1;
+    }
+}
+
+static unsigned long timeout_latches;
+
+static void timeout_latch(unsigned long state)
+{
+    (void)state;
+    timeout_latches++;
+}
+
+/* Truncated frame: dropped after the timeout, the Tx takes the next one */
+static void test_frame_timeout(const unsigned char *data, unsigned char frame_max)
+{
+    unsigned char left;
+    
+    sim_tx_reset();
+    timeout_latches = 0;
+    sim_latch_hook = timeout_latch;
+    
+    left = sim_tx_send_truncated(data, frame_max, frame_max - 1);
+    if (left != 0)
+    {
+        fail("timeout", 0, "bytes left in rx_fifo", left, 0);
+    }
+    if (timeout_latches != 0)
+    {
+        fail("timeout", 0, "latches of a truncated frame", timeout_latches, 0);
+    }
+    
+    /* R bytes are a whole number of symbols for every R */
+    if (frame_max >= hamming_r)
+    {
+        sim_tx_send_frame(data, hamming_r);
+        if (timeout_latches != 8UL / lanes)
+        {
+            fail("timeout", 1, "latches of the next frame", timeout_latches, 8UL / lanes);
+        }
+    }
+    
+    sim_latch_hook = 0;
+}
+
+static void test_frames(unsigned long count)
+{
+    unsigned char *data;
+    unsigned long i;
+    unsigned long sent;
+    unsigned char len;
+    unsigned long resyncs = 0;
+    unsigned char frame_max = sim_tx_frame_max();
+    unsigned char resync;
+    
+    if (frame_max == 0)
+    {
+        printf("  skipped (TX_BURST_ENABLE = 0)\n");
+        return;
+    }
+    
+    /* Without resync a multiple of R bytes leaves no carried bits in
+     * tx_handler.c; with it the final CTRL_RESYNC sends them */
+    sim_tx_reset();
+    resync = sim_tx_resync();
+    if (!resync)
+    {
+        count -= count % hamming_r;
+    }
+    
+    data = malloc(count);
+    frame_out = malloc(count);
+    if (!data || !frame_out)
+    {
+        printf("  out of memory\n");
+        failures++;
+        free(data);
+        free(frame_out);
+        return;
+    }
+    for (i = 0; i < count; i++)
+    {
+        data[i] = (unsigned char)sim_random();
+    }
+    
+    sim_tx_reset();
+    sim_rx_reset(sim_rx_raw_from_lines(0));
+    frame_out_len = 0;
+    frame_acc = 0;
+    frame_bits = 0;
+    frame_latches = 0;
+    frame_prev_state = 0;
+    frame_markers = 0;
+    frame_pad_bits = 0;
+    sim_latch_hook = frame_latch;
+    
+    for (sent = 0; sent < count; sent += len)
+    {
+        len = resync ? (unsigned char)(1 + sim_random() % frame_max) : frame_max;
+        if (len > count - sent)
+        {
+            len = (unsigned char)(count - sent);
+        }
+        sim_tx_send_frame(data + sent, len);
+    
+        if (resync && ((sim_random() & 0x07) == 0 || sent + len == count))
+        {
+            sim_tx_resync();
+            resyncs++;
+        }
+    }
+    
+    sim_latch_hook = 0;
+    
+    if (resync)
+    {
+        printf("  %lu resync(s), %lu marker state(s)\n", resyncs, frame_markers);
+    }
+    if (frame_latches * hamming_r * lanes != count * 8 + frame_pad_bits)
+    {
+        fail("frame", 0, "latched states", frame_latches,
+             (count * 8 + frame_pad_bits) / (hamming_r * lanes));
+    }
+    if (frame_out_len != count)
+    {
+        fail("frame", 0, "decoded bytes", frame_out_len, count);
+    }
+    else
+    {
+        for (i = 0; i < count; i++)
+        {
+            if (frame_out[i] != data[i])
+            {
+                fail("frame", i, "decoded byte", frame_out[i], data[i]);
+            }
+        }
+    }
+    
+    test_frame_timeout(data, frame_max);
+    
+    free(data);
+    free(frame_out);
+}
+
+/* --- Pass 4: stable-read filter, read_bus_raw() on scripted port reads --- */
+
+static unsigned long stable_raw[SIM_STABLE_ENTRIES];
+static unsigned long stable_b[SIM_STABLE_ENTRIES];
+
+/* Script entry the ports show in a pass (the last one repeats) */
+static unsigned int stable_entry(unsigned long pass)
+{
+    return (pass < SIM_STABLE_ENTRIES) ? (unsigned int)pass : SIM_STABLE_ENTRIES - 1;
+}
+
+static int stable_same(unsigned long pass_a, unsigned long pass_b)
+{
+    unsigned int a = stable_entry(pass_a);
+    unsigned int b = stable_entry(pass_b);
+    
+    return stable_raw[a] == stable_raw[b] && stable_b[a] == stable_b[b];
+}
+
+/* Reference for one snapshot from pass `start`: reads until `reads` passes
+ * in a row agree, or gives up after `window` passes (0 = never). Returns
+ * the last pass it took; *ok = 0 if it gave up. */
+static unsigned long stable_snapshot(unsigned long start, unsigned char reads,
+                                     unsigned char window, int *ok)
+{
+    unsigned long pass = start;
+    unsigned long taken = 1;
+    unsigned int run = 1;
+    
+    while (run < reads)
+    {
+        pass++;
+        taken++;
+        run = stable_same(pass, pass - 1) ? run + 1 : 1;
+        if (window != 0 && taken >= window && run < reads)
+        {
+            *ok = 0;
+            return pass;
+        }
+    }
+    
+    *ok = 1;
+    return pass;
+}
+
+/* Lane A port word of `lines` (even over lines + aux unless `odd`) */
+static unsigned long stable_value(unsigned long lines, int odd)
+{
+    if (aux_parity && ((popcount(lines) & 1) != (unsigned int)odd))
+    {
+        lines |= 1UL << hamming_n;
+    }
+    
+    return sim_rx_raw_from_lines(lines);
+}
+
+static void test_stable_reads(unsigned long count)
+{
+    unsigned char reads = sim_rx_stable_reads();
+    unsigned char window = sim_rx_stable_window();
+    unsigned char retries = sim_rx_aux_retries();
+    unsigned long line_mask = (1UL << hamming_n) - 1;
+    unsigned long pool_lines[3];
+    unsigned long pool_raw[3];
+    unsigned long pool_b[3];
+    unsigned long mix;
+    unsigned long script;
+    unsigned long pass;
+    unsigned long end;
+    unsigned long raw;
+    unsigned long lines_b;
+    unsigned long passes;
+    unsigned int entry;
+    unsigned int run;
+    unsigned int j;
+    unsigned char tries;
+    unsigned char error;
+    int expect_error;
+    int ok;
+    
+    printf("  %lu scripts, RX_STABLE_READS = %u, RX_STABLE_WINDOW = %u%s\n", count,
+           reads, window, retries ? ", aux retries" : "");
+    
+    for (script = 0; script < count; script++)
+    {
+        /* Runs of 1 .. reads + 1 equal passes from a pool of three states:
+         * a bus state, the next one (with two lanes: only lane B changed)
+         * and a mix of both, as a read across the latch edge sees it. One
+         * in four is odd over the aux line when it is wired. */
+        pool_lines[0] = sim_random() & line_mask;
+        pool_b[0] = sim_random() & line_mask;
+        pool_lines[1] = (lanes == 2) ? pool_lines[0] : (sim_random() & line_mask);
+        pool_b[1] = sim_random() & line_mask;
+        mix = sim_random();
+        pool_lines[2] = (pool_lines[0] & mix) | (pool_lines[1] & ~mix);
+        pool_b[2] = (pool_b[0] & mix) | (pool_b[1] & ~mix);
+        for (j = 0; j < 3; j++)
+        {
+            pool_raw[j] = stable_value(pool_lines[j], aux_parity && (sim_random() & 3) == 0);
+            if (lanes != 2)
+            {
+                pool_b[j] = 0;
+            }
+        }
+        for (entry = 0; entry < SIM_STABLE_ENTRIES; )
+        {
+            j = (unsigned int)(sim_random() % 3);
+            run = 1 + (unsigned int)(sim_random() % (reads + 1u));
+            for ( ; run != 0 && entry < SIM_STABLE_ENTRIES; run--, entry++)
+            {
+                stable_raw[entry] = pool_raw[j];
+                stable_b[entry] = pool_b[j];
+            }
+        }
+        
+        /* Expected: snapshots as read_bus_raw() takes them, again after an
+         * odd or unstable one up to RX_AUX_RETRIES times */
+        pass = 0;
+        tries = retries;
+        do
+        {
+            end = stable_snapshot(pass, reads, window, &ok);
+            expect_error = !ok || !sim_rx_aux_ok(stable_raw[stable_entry(end)]);
+            pass = end + 1;
+        } while (expect_error && tries-- != 0);
+        
+        sim_rx_port_script(stable_raw, stable_b, SIM_STABLE_ENTRIES);
+        raw = sim_rx_read(&lines_b, &passes, &error);
+        
+        if (passes != pass)
+        {
+            fail("stable", script, "port passes", passes, pass);
+        }
+        if (error != expect_error)
+        {
+            fail("stable", script, "rx_read_error", error, expect_error);
+        }
+        else if (!error && raw != stable_raw[stable_entry(end)])
+        {
+            fail("stable", script, "read_bus_raw", raw, stable_raw[stable_entry(end)]);
+        }
+        else if (!error && lines_b != stable_b[stable_entry(end)])
+        {
+            fail("stable", script, "rx_raw_b", lines_b, stable_b[stable_entry(end)]);
+        }
+    }
+}
+
+/* --- Pass 5: benchmarks --- */
+
+/* Budget file: one "<side> <function> <ns/call>" line per function,
+ * '#' starts a comment line */
+typedef struct
+{
+    char side[4];
+    char name[40];
+    double instr;                       /* Host instructions per call */
+} budget_t;
+
+static budget_t budget[SIM_BUDGET_MAX];
+static int budget_count = -1;           /* -1: no budget loaded */
+static int budget_r = -1;               /* Header "# R = r, l lane(s)", -1: none */
+static int budget_lanes = -1;
+static double budget_tolerance = SIM_BUDGET_TOLERANCE;
+static FILE *budget_out;
+static unsigned long over_budget;
+
+static int budget_load(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    char line[128];
+    char *last;
+    char *name;
+    size_t len;
+    unsigned int r;
+    unsigned int l;
+    
+    if (!f)
+    {
+        return 0;
+    }
+    budget_count = 0;
+    while (fgets(line, sizeof(line), f) && budget_count < SIM_BUDGET_MAX)
+    {
+        len = strcspn(line, "\r\n");
+        line[len] = 0;
+        if (sscanf(line, "# R = %u, %u lane", &r, &l) == 2)
+        {
+            budget_r = (int)r;
+            budget_lanes = (int)l;
+        }
+        last = strrchr(line, ' ');
+        name = strchr(line, ' ');
+        if (line[0] == '#' || !last || name == last || name - line >= 4)
+        {
+            continue;
+        }
+        memcpy(budget[budget_count].side, line, name - line);
+        budget[budget_count].side[name - line] = 0;
+        while (*name == ' ')
+        {
+            name++;
+        }
+        while (last > name && last[-1] == ' ')
+        {
+            last--;
+        }
+        if (last - name >= (long)sizeof(budget[0].name))
+        {
+            continue;
+        }
+        memcpy(budget[budget_count].name, name, last - name);
+        budget[budget_count].name[last - name] = 0;
+        budget[budget_count].instr = strtod(last, 0);
+        budget_count++;
+    }
+    fclose(f);
+    
+    return 1;
+}
+
+/* Budget entry of a benchmark, -1 if there is none */
+static int budget_find(const char *side, const char *name)
+{
+    int i;
+    
+    for (i = 0; i < budget_count; i++)
+    {
+        if (strcmp(budget[i].side, side) == 0 && strcmp(budget[i].name, name) == 0)
+        {
+            return i;
+        }
+    }
+    
+    return -1;
+}
+
+/* Budget column of the table; counts functions over budget */
+static void budget_report(const char *side, const char *name, int entry, double instr)
+{
+    if (budget_out && instr >= 0)
+    {
+        fprintf(budget_out, "%-3s %-28s %8.2f\n", side, name, instr);
+    }
+    if (budget_count < 0)
+    {
+        printf("\n");
+        return;
+    }
+    if (entry < 0)
+    {
+        printf(" %10s\n", "(none)");
+        return;
+    }
+    
+    printf(" %10.2f %+6.0f%%", budget[entry].instr,
+           budget[entry].instr > 0 ? (instr / budget[entry].instr - 1) * 100 : 0);
+    if (instr < 0 || instr > budget[entry].instr * (1 + budget_tolerance / 100))
+    {
+        printf("  OVER BUDGET");
+        over_budget++;
+    }
+    printf("\n");
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static unsigned long long now_cycles(void)
+{
+#if SIM_HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    
+    return (x > y) - (x < y);
+}
+
+static double median(double *values, int count)
+{
+    qsort(values, count, sizeof(values[0]), compare_double);
+    
+    return (count & 1) ? values[count / 2]
+                       : (values[count / 2 - 1] + values[count / 2]) / 2;
+}
+
+/* One run of bench, per call */
+static void bench_run(const sim_bench_t *bench, unsigned long iterations,
+                      double *ns, double *cycles)
+{
+    double t0;
+    unsigned long long c0;
+    
+    t0 = now_ns();
+    c0 = now_cycles();
+    bench->run(iterations);
+    *cycles = (double)(now_cycles() - c0) / iterations;
+    *ns = (now_ns() - t0) / iterations;
+}
+
+/* Host instructions run by bench for SIM_COUNT_CALLS calls: a forked
+ * child runs it under ptrace, one PTRACE_SINGLESTEP per instruction. The
+ * count does not depend on the host load. -1 if the host does not allow
+ * tracing. The inputs must already be prepared (bench_table times the
+ * entry first), or the child would count bench_prepare() too. */
+static long bench_count(const sim_bench_t *bench)
+{
+#if SIM_HAVE_PTRACE
+    pid_t pid;
+    int status;
+    long steps = 0;
+    
+    fflush(stdout);
+    pid = fork();
+    if (pid < 0)
+    {
+        return -1;
+    }
+    if (pid == 0)
+    {
+        if (ptrace(PTRACE_TRACEME, 0, 0, 0) == 0)
+        {
+            raise(SIGSTOP);
+            bench->run(SIM_COUNT_CALLS);
+        }
+        _exit(0);
+    }
+    
+    if (waitpid(pid, &status, 0) != pid || !WIFSTOPPED(status))
+    {
+        return -1;
+    }
+    while (ptrace(PTRACE_SINGLESTEP, pid, 0, 0) == 0 &&
+           waitpid(pid, &status, 0) == pid && WIFSTOPPED(status))
+    {
+        steps++;
+    }
+    
+    return WIFEXITED(status) ? steps : -1;
+#else
+    (void)bench;
+    return -1;
+#endif
+}
+
+/* Times every entry of a table per call, minus entry 0: each of
+ * SIM_BENCH_REPEAT rounds runs the entries back to back, from entry 0, so
+ * the samples of one function are spread over the whole timing; the
+ * figures are the medians over the rounds. Then counts the host
+ * instructions per call (bench_count, minus entry 0), which is what the
+ * budget checks: the time follows the host load, the count does not. */
+static void bench_table(const char *side, const sim_bench_t *table,
+                        unsigned char count, unsigned long iterations)
+{
+    static double run_ns[SIM_BENCH_MAX][SIM_BENCH_REPEAT];
+    static double run_cycles[SIM_BENCH_MAX][SIM_BENCH_REPEAT];
+    double ns;
+    double cycles;
+    double instr;
+    long base_steps;
+    long steps;
+    unsigned char i;
+    int run;
+    
+    if (count > SIM_BENCH_MAX)
+    {
+        count = SIM_BENCH_MAX;
+    }
+    
+    for (run = 0; run < SIM_BENCH_REPEAT; run++)
+    {
+        bench_run(&table[0], iterations, &run_ns[0][run], &run_cycles[0][run]);
+        for (i = 1; i < count; i++)
+        {
+            bench_run(&table[i], iterations, &run_ns[i][run], &run_cycles[i][run]);
+            run_ns[i][run] -= run_ns[0][run];
+            run_cycles[i][run] -= run_cycles[0][run];
+        }
+    }
+    base_steps = bench_count(&table[0]);
+    
+    printf("  %-3s %-28s %10s %12s %12s%s\n", side, "function", "ns/call", "cycles/call",
+           "instr/call", budget_count < 0 ? "" : "     budget");
+    for (i = 0; i < count; i++)
+    {
+        ns = median(run_ns[i], SIM_BENCH_REPEAT);
+        cycles = median(run_cycles[i], SIM_BENCH_REPEAT);
+        printf("  %-3s %-28s %10.2f %12.1f", "", table[i].name,
+               ns > 0 ? ns : 0, cycles > 0 ? cycles : 0);
+        if (i == 0)
+        {
+            printf("\n");
+            continue;
+        }
+        
+        steps = bench_count(&table[i]);
+        instr = (steps < 0 || base_steps < 0) ? -1 :
+                (double)(steps - base_steps) / SIM_COUNT_CALLS;
+        if (instr < 0)
+        {
+            printf(" %12s", "n/a");
+        }
+        else
+        {
+            printf(" %12.2f", instr);
+        }
+        budget_report(side, table[i].name, budget_find(side, table[i].name), instr);
+    }
+}
+
+/* MAIN FUNCTION */
+int main(int argc, char **argv)
+{
+    unsigned long symbols = SIM_DEFAULT_SYMBOLS;
+    unsigned long bench = SIM_DEFAULT_BENCH;
+    unsigned long long seed = 1;
+    const char *budget_path = 0;
+    const char *write_path = 0;
+    int i;
+    
+    for (i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "-n") == 0)
+        {
+            symbols = strtoul(argv[i + 1], 0, 0);
+        }
+        else if (strcmp(argv[i], "-b") == 0)
+        {
+            bench = strtoul(argv[i + 1], 0, 0);
+        }
+        else if (strcmp(argv[i], "-s") == 0)
+        {
+            seed = strtoull(argv[i + 1], 0, 0);
+        }
+        else if (strcmp(argv[i], "-B") == 0)
+        {
+            budget_path = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "-W") == 0)
+        {
+            write_path = argv[i + 1];
+        }
+        else if (strcmp(argv[i], "-t") == 0)
+        {
+            budget_tolerance = strtod(argv[i + 1], 0);
+        }
+        else
+        {
+            break;
+        }
+    }
+    if (i < argc)
+    {
+        fprintf(stderr, "usage: %s [-n symbols] [-b bench_iterations] [-s seed]\n"
+                        "       [-B budget_file [-t percent]] [-W budget_file]\n", argv[0]);
+        return 2;
+    }
+    if (budget_path && !budget_load(budget_path))
+    {
+        fprintf(stderr, "cannot read budget file %s\n", budget_path);
+        return 2;
+    }
+    rng_state ^= seed * 0x2545F4914F6CDD1DULL;
+    if (rng_state == 0)
+    {
+        rng_state = 1;
+    }
+    
+    hamming_r = sim_tx_hamming_r();
+    if (sim_rx_hamming_r() != hamming_r)
+    {
+        printf("HAMMING_R differs: Tx %u, Rx %u\n", hamming_r, sim_rx_hamming_r());
+        return 1;
+    }
+    lanes = sim_tx_lanes();
+    if (sim_rx_lanes() != lanes)
+    {
+        printf("Lane count differs: Tx %u, Rx %u\n", lanes, sim_rx_lanes());
+        return 1;
+    }
+    
+    if (budget_path && (budget_r != hamming_r || budget_lanes != lanes))
+    {
+        fprintf(stderr, "budget file %s is not for this build (R = %u, %u lane(s)): "
+                        "rewrite it with make budget\n", budget_path, hamming_r, lanes);
+        return 2;
+    }
+    
+    aux_parity = sim_tx_aux_parity();
+    if (sim_rx_aux_parity() != aux_parity)
+    {
+        printf("Aux parity line differs: Tx %u, Rx %u\n", aux_parity, sim_rx_aux_parity());
+        return 1;
+    }
+    hamming_n = (unsigned char)((1u << hamming_r) - 1);
+    
+    printf("H1 bus simulator: R = %u, N = %u lines, %u lane(s)%s\n", hamming_r,
+           hamming_n, lanes, aux_parity ? ", aux parity line" : "");
+    
+    printf("Symbol round trip: %lu symbols\n", symbols);
+    test_symbols(symbols);
+    
+    printf("State sweep\n");
+    test_sweep();
+    
+    printf("Byte round trip: %lu bytes in CTRL_BURST frames\n", symbols * hamming_r / 8);
+    test_frames(symbols * hamming_r / 8);
+    
+    printf("Stable-read filter\n");
+    test_stable_reads(SIM_STABLE_SCRIPTS);
+    
+    if (failures)
+    {
+        printf("FAILED: %lu check(s)\n", failures);
+        return 1;
+    }
+    printf("Round trips OK\n");
+    
+    if (bench)
+    {
+        bench -= bench % SIM_BENCH_BATCH;
+        if (bench == 0)
+        {
+            bench = SIM_BENCH_BATCH;
+        }
+        printf("Benchmarks: %lu calls, median of %d%s\n", bench, SIM_BENCH_REPEAT,
+               SIM_HAVE_TSC ? "" : " (no TSC: cycles not available)");
+        if (write_path)
+        {
+            budget_out = fopen(write_path, "w");
+            if (!budget_out)
+            {
+                fprintf(stderr, "cannot write budget file %s\n", write_path);
+                return 2;
+            }
+            fprintf(budget_out, "# h1_sim benchmark budget: host instructions per call, counted over %d calls\n"
+                                "# R = %u, %u lane(s). Written by h1_sim -W, checked by -B (make bench-check)\n",
+                    SIM_COUNT_CALLS, hamming_r, lanes);
+        }
+        bench_table("Tx", sim_tx_benches, sim_tx_bench_count, bench);
+        bench_table("Rx", sim_rx_benches, sim_rx_bench_count, bench);
+        if (budget_out)
+        {
+            fclose(budget_out);
+            printf("Budget written to %s\n", write_path);
+        }
+        if (over_budget)
+        {
+            printf("FAILED: %lu function(s) more than %.0f%% over budget\n",
+                   over_budget, budget_tolerance);
+            return 1;
+        }
+        if (budget_count >= 0)
+        {
+            printf("Within budget (+%.0f%%)\n", budget_tolerance);
+        }
+    }
+    
+    return 0;
+}
@@ -0,0 +1,336 @@
+/* File: sim_rx.c
+ * Host glue for the Rx decoder and input sources (Rx_decoder.c,
+ * Rx_input.c).
+ *
+ * The simulator hands the decoder the raw port word read_bus_raw() would
+ * return for a given bus state, so bus_lines_from_raw() is exercised with
+ * the real port layout (RAW_BUS_MASK in the Rx header.h).
+ * read_bus_raw() itself runs on scripted port values (sim_port_read()).
+ *
+ * Compiled against the Rx header.h.
+ */
+
+#include <aduc841.h>
+#include "header.h"
+#include "sim.h"
+
+unsigned char sim_rx_hamming_r(void)
+{
+    return HAMMING_R;
+}
+
+unsigned char sim_rx_lanes(void)
+{
+    return RX_LANES;
+}
+
+unsigned char sim_rx_aux_parity(void)
+{
+    return RX_AUX_PARITY;
+}
+
+/* read_bus_raw() accepts the snapshot (always without RX_AUX_PARITY) */
+unsigned char sim_rx_aux_ok(unsigned long raw)
+{
+#if RX_AUX_PARITY
+    return aux_parity_ok((uint16_t)raw);
+#else
+    (void)raw;
+    return 1;
+#endif
+}
+
+/* Line order -> port order, the inverse of bus_lines_from_raw(). Bit N
+ * is the aux line (RX_AUX_PARITY), dropped when it is not wired. */
+unsigned long sim_rx_raw_from_lines(unsigned long lines)
+{
+#if (HAMMING_R == 4)
+    return (lines & 0x00FF)             /* Lines 1-8   -> P2.0-P2.7 */
+         | ((lines & 0x0F00) << 4)      /* Lines 9-12  -> P3.4-P3.7 */
+         | ((lines >> 4) & (0x0700 | RX_AUX_RAW_BIT));  /* Lines 13-15 -> P0.0-P0.2, aux -> P3.3 */
+#else
+    return lines & RAW_BUS_MASK;
+#endif
+}
+
+unsigned long sim_rx_lines_from_raw(unsigned long raw)
+{
+    return bus_lines_from_raw((uint16_t)raw);
+}
+
+void sim_rx_reset(unsigned long raw)
+{
+    rx_decode_reset((uint16_t)raw);
+}
+
+unsigned char sim_rx_decode(unsigned long raw)
+{
+    return rx_decode_step((uint16_t)raw);
+}
+
+unsigned char sim_rx_toggled(void)
+{
+    return rx_toggled_line;
+}
+
+/* Last sample was a resync marker: 1 = RX_TOGGLE_SKIP, 2 = RX_TOGGLE_RESYNC */
+unsigned char sim_rx_marker(void)
+{
+#if RX_RESYNC_ENABLE
+    if (rx_toggled_line == RX_TOGGLE_SKIP)
+    {
+        return 1;
+    }
+    if (rx_toggled_line == RX_TOGGLE_RESYNC)
+    {
+        return 2;
+    }
+#endif
+    return 0;
+}
+
+/* Array path: one byte per line through get_S_from_X() */
+unsigned char sim_rx_decode_x(unsigned long lines)
+{
+    uint8_t X[HAMMING_N];
+    uint8_t S[HAMMING_R];
+    uint8_t i;
+    
+    for (i = 0; i < HAMMING_N; i++)
+    {
+        X[i] = (uint8_t)((lines >> i) & 0x01);
+    }
+    get_S_from_X(X, HAMMING_R, S);
+    
+    return bits_to_decimal(S, HAMMING_R);
+}
+
+/* Lane B as in main.c: rx_raw_b is already in line order */
+unsigned char sim_rx_decode_b(unsigned long lines)
+{
+    return get_S_from_lines((uint16_t)lines);
+}
+
+/* --- Port replay for read_bus_raw() ---
+ * Rx_input.c is built with SIM_PORT_REPLAY, so each P0..P3 read in it
+ * calls sim_port_read(). Script entry i is what the ports show during the
+ * i-th pass over them (one READ_BUS(), plus READ_LANE_B() with two
+ * lanes). A read picks its entry from how often that port has been read,
+ * so the order of the reads within a pass does not matter. After the last
+ * entry the ports keep its value. Pins that carry no bus line get random
+ * bits, which read_bus_raw() must mask off.
+ */
+
+#define REPLAY_MAX      256
+
+static uint8_t replay_port[REPLAY_MAX][4];
+static unsigned int replay_count = 1;
+static unsigned long replay_reads[4];
+
+/* Reads of P0..P3 per pass */
+#if (HAMMING_R == 4) && (RX_LANES == 2)
+static const uint8_t replay_per_pass[4] = { 2, 1, 1, 2 };
+#elif (HAMMING_R == 4)
+static const uint8_t replay_per_pass[4] = { 1, 0, 1, 1 };
+#else
+static const uint8_t replay_per_pass[4] = { 0, 0, 1, 0 };
+#endif
+
+unsigned char sim_port_read(unsigned char port)
+{
+    unsigned long entry = 0;
+    
+    if (replay_per_pass[port] != 0)
+    {
+        entry = replay_reads[port]++ / replay_per_pass[port];
+    }
+    if (entry >= replay_count)
+    {
+        entry = replay_count - 1;
+    }
+    
+    return replay_port[entry][port];
+}
+
+/* raw[i]: read_bus_raw() word of lane A, lines_b[i]: lane B lines (two
+ * lanes only, may be 0 otherwise). At most REPLAY_MAX entries. */
+void sim_rx_port_script(const unsigned long *raw, const unsigned long *lines_b,
+                        unsigned int count)
+{
+    unsigned int i;
+    uint8_t *port;
+#if (HAMMING_R == 4)
+    uint8_t p3_mask = (uint8_t)(0xF0 | (RX_AUX_RAW_BIT >> 8));
+#endif
+    
+    replay_count = (count < 1) ? 1 : (count > REPLAY_MAX) ? REPLAY_MAX : count;
+    for (i = 0; i < replay_count; i++)
+    {
+        port = replay_port[i];
+        port[0] = (uint8_t)sim_random();
+        port[1] = (uint8_t)sim_random();
+        port[2] = (uint8_t)sim_random();
+        port[3] = (uint8_t)sim_random();
+#if (HAMMING_R == 4)
+        port[2] = (uint8_t)raw[i];
+        port[0] = (uint8_t)((port[0] & 0xF8) | ((raw[i] >> 8) & 0x07));
+        port[3] = (uint8_t)((port[3] & ~p3_mask) | ((raw[i] >> 8) & p3_mask));
+#if (RX_LANES == 2)
+        port[1] = (uint8_t)lines_b[i];
+        port[0] = (uint8_t)((port[0] & 0x07) | ((lines_b[i] >> 5) & 0xF8));
+        port[3] = (uint8_t)((port[3] & 0xF3) | ((lines_b[i] >> 11) & 0x0C));
+#endif
+#else
+        port[2] = (uint8_t)((port[2] & ~RAW_BUS_MASK) | (raw[i] & RAW_BUS_MASK));
+#endif
+    }
+    (void)lines_b;
+    
+    for (i = 0; i < 4; i++)
+    {
+        replay_reads[i] = 0;
+    }
+}
+
+/* read_bus_raw() on the script from its first entry. *lines_b: rx_raw_b,
+ * *passes: passes over the ports it took, *error: rx_read_error. */
+unsigned long sim_rx_read(unsigned long *lines_b, unsigned long *passes,
+                          unsigned char *error)
+{
+    unsigned long raw = read_bus_raw();
+    
+#if (RX_LANES == 2)
+    *lines_b = rx_raw_b;
+#else
+    *lines_b = 0;
+#endif
+    *passes = replay_reads[2];     /* P2 is read once per pass */
+#if RX_READ_CHECKED
+    *error = rx_read_error;
+#else
+    *error = 0;
+#endif
+    
+    return raw;
+}
+
+unsigned char sim_rx_stable_reads(void)
+{
+    return RX_STABLE_READS;
+}
+
+unsigned char sim_rx_stable_window(void)
+{
+    return RX_STABLE_WINDOW;
+}
+
+/* Extra snapshots after an odd one, 0 without the aux line */
+unsigned char sim_rx_aux_retries(void)
+{
+#if RX_AUX_PARITY
+    return RX_AUX_RETRIES;
+#else
+    return 0;
+#endif
+}
+
+/* --- Benchmarks --- */
+
+#define BENCH_INPUTS    4096    /* Power of two */
+#define BENCH_MASK      (BENCH_INPUTS - 1)
+#define LINE_MASK       ((1UL << HAMMING_N) - 1)
+
+static uint16_t bench_lines[BENCH_INPUTS];
+static uint16_t bench_raw[BENCH_INPUTS];
+static uint8_t bench_x[BENCH_INPUTS][HAMMING_N];
+static bit bench_ready = 0;
+
+volatile unsigned long sim_rx_sink;
+
+static void bench_prepare(void)
+{
+    unsigned int i;
+    uint8_t j;
+    
+    if (bench_ready)
+    {
+        return;
+    }
+    
+    for (i = 0; i < BENCH_INPUTS; i++)
+    {
+        bench_lines[i] = (uint16_t)(sim_random() & LINE_MASK);
+        bench_raw[i] = (uint16_t)sim_rx_raw_from_lines(bench_lines[i]);
+        for (j = 0; j < HAMMING_N; j++)
+        {
+            bench_x[i][j] = (uint8_t)((bench_lines[i] >> j) & 0x01);
+        }
+    }
+    bench_ready = 1;
+}
+
+/* Chained: each input depends on the last result, so the time is the
+ * latency of the call and not lost under the empty-call loop */
+#define LINES_CALL(k)  acc = bus_lines_from_raw((uint16_t)(bench_raw[(k) & BENCH_MASK] ^ (acc & 1)))
+static void bench_lines_from_raw(unsigned long iterations)
+{
+    unsigned long i;
+    uint16_t acc = 0;
+    
+    bench_prepare();
+    SIM_BENCH_LOOP(i, iterations, LINES_CALL)
+    sim_rx_sink = acc;
+}
+
+#define SYNDROME_CALL(k)  acc ^= get_S_from_lines(bench_lines[(k) & BENCH_MASK])
+static void bench_syndrome(unsigned long iterations)
+{
+    unsigned long i;
+    uint8_t acc = 0;
+    
+    bench_prepare();
+    SIM_BENCH_LOOP(i, iterations, SYNDROME_CALL)
+    sim_rx_sink = acc;
+}
+
+#define DECODE_CALL(k)  acc ^= rx_decode_step(bench_raw[(k) & BENCH_MASK])
+static void bench_decode_step(unsigned long iterations)
+{
+    unsigned long i;
+    uint8_t acc = 0;
+    
+    bench_prepare();
+    SIM_BENCH_LOOP(i, iterations, DECODE_CALL)
+    sim_rx_sink = acc;
+}
+
+#define DECODE_X_CALL(k)  get_S_from_X(bench_x[(k) & BENCH_MASK], HAMMING_R, S)
+static void bench_decode_x(unsigned long iterations)
+{
+    unsigned long i;
+    uint8_t S[HAMMING_R];
+    
+    bench_prepare();
+    SIM_BENCH_LOOP(i, iterations, DECODE_X_CALL)
+    sim_rx_sink = S[0];
+}
+
+/* Same loop around an empty out-of-line call (subtracted by sim_main.c) */
+#define NOP_CALL(k)  sim_bench_nop((unsigned char)bench_raw[(k) & BENCH_MASK])
+static void bench_overhead(unsigned long iterations)
+{
+    unsigned long i;
+    
+    bench_prepare();
+    SIM_BENCH_LOOP(i, iterations, NOP_CALL)
+}
+
+const sim_bench_t sim_rx_benches[] =
+{
+    { "(call overhead)",    bench_overhead },
+    { "bus_lines_from_raw", bench_lines_from_raw },
+    { "get_S_from_lines",   bench_syndrome },
+    { "rx_decode_step",     bench_decode_step },
+    { "get_S_from_X",       bench_decode_x },
+};
+const unsigned char sim_rx_bench_count = sizeof(sim_rx_benches) / sizeof(sim_rx_benches[0]);
@@ -0,0 +1,395 @@
+/* File: sim_tx.c
+ * Host glue for the Tx encoder sources (bus_encoder.c, tx_handler.c).
+ *
+ * Provides what main.c, peripherals.c, shift_output.c and tx_stats.c
+ * provide on the target: the encoder globals, the UART receive FIFO, and
+ * stand-ins for the hardware functions. Every latched bus state is passed
+ * to sim_latch_hook (sim_main.c) instead of the 74HC595 chain.
+ *
+ * Compiled against the Tx header.h, so all configuration switches there
+ * (HAMMING_R, SYNDROME_KERNEL, TX_BURST_ENABLE, ...) apply unchanged.
+ */
+
+#include <signal.h>
+#include <sys/time.h>
+#include <aduc841.h>
+#include "header.h"
+#include "sim.h"
+
+/* --- Globals normally defined in main.c / peripherals.c --- */
+volatile bus_state_t current_bus_state = 0;
+volatile uint8_t current_syndrome = 0;
+#if ENCODER_DEBUG
+volatile uint8_t syndrome_mismatch_count = 0;
+#endif
+#if (TX_LANES == 2)
+volatile bus_state_t current_bus_state_b = 0;
+volatile uint8_t current_syndrome_b = 0;
+#endif
+
+volatile bit buffer_flag = 0;
+volatile uint8_t buffer_count = 0;
+
+#if TX_TOGGLE_STATS
+unsigned long toggle_symbols = 0;
+unsigned long toggle_total = 0;
+uint16_t idata toggle_line[HAMMING_N];
+#endif
+
+volatile uint8_t idata rx_fifo[RX_FIFO_SIZE];
+volatile uint8_t rx_fifo_head = 0;
+volatile uint8_t rx_fifo_tail = 0;
+volatile uint8_t rx_overrun_count = 0;
+volatile uint8_t rx_fifo_peak = 0;
+
+volatile bit uart_tx_busy = 0;
+volatile bit baud_revert_flag = 0;
+volatile uint8_t baud_index = UART_BAUD_DEFAULT;
+volatile uint8_t timer1_ticks = 0;
+
+/* --- Hardware stand-ins --- */
+
+/* shift_out_state: the "latch" is a call of sim_latch_hook */
+void shift_out_state(tx_word_t state)
+{
+    state &= TX_WORD_MASK;
+#if TX_AUX_PARITY
+    if (bus_parity(state))
+    {
+        state |= TX_AUX_BIT;
+    }
+#endif
+    
+    if (sim_latch_hook)
+    {
+        sim_latch_hook((unsigned long)state);
+    }
+}
+
+void output_to_shift_registers(void)
+{
+#if (TX_LANES == 2)
+    shift_out_state(TX_WORD(current_bus_state, current_bus_state_b));
+#else
+    shift_out_state(current_bus_state);
+#endif
+}
+
+/* Uplink bytes (credits, stats replies) are not modelled */
+void uart_putc(uint8_t value)
+{
+    (void)value;
+}
+
+void baud_request(uint8_t index)
+{
+    (void)index;
+}
+
+#if TX_INSTRUMENT
+/* No Timer 0 on the host: stages cost nothing extra, dumps are dropped */
+uint16_t stamp_now(void)
+{
+    return 0;
+}
+
+void stat_record(uint8_t stage, uint16_t start)
+{
+    (void)stage;
+    (void)start;
+}
+
+void stat_handoff_take(void)
+{
+}
+
+void stats_dump(uint8_t clear)
+{
+    (void)clear;
+}
+#endif
+
+#if TX_TOGGLE_STATS
+void toggles_dump(uint8_t clear)
+{
+    (void)clear;
+}
+#endif
+
+/* --- Simulator interface (sim.h) --- */
+
+unsigned char sim_tx_hamming_r(void)
+{
+    return HAMMING_R;
+}
+
+unsigned char sim_tx_lanes(void)
+{
+    return TX_LANES;
+}
+
+unsigned char sim_tx_aux_parity(void)
+{
+    return TX_AUX_PARITY;
+}
+
+/* Largest payload sim_tx_send_frame() accepts: the whole frame is queued
+ * before tx_handler() runs, so it must fit in rx_fifo */
+unsigned char sim_tx_frame_max(void)
+{
+#if TX_BURST_ENABLE
+    return (TX_BURST_MAX_BYTES < RX_FIFO_SIZE - 3) ? TX_BURST_MAX_BYTES : (RX_FIFO_SIZE - 3);
+#else
+    return 0;
+#endif
+}
+
+/* Power-up state: all-zero bus, syndrome 0, empty FIFO */
+void sim_tx_reset(void)
+{
+    current_bus_state = 0;
+    current_syndrome = 0;
+#if (TX_LANES == 2)
+    current_bus_state_b = 0;
+    current_syndrome_b = 0;
+#endif
+    rx_fifo_head = 0;
+    rx_fifo_tail = 0;
+}
+
+unsigned long sim_tx_encode(unsigned char symbol)
+{
+    encode_nibble(symbol);
+    
+    return (unsigned long)current_bus_state;
+}
+
+/* Bus state with its syndrome in the cache, as after a real symbol */
+void sim_tx_set_state(unsigned long state)
+{
+    current_bus_state = (bus_state_t)(state & BUS_STATE_MASK);
+    current_syndrome = compute_syndrome_from_bus(current_bus_state);
+}
+
+unsigned long sim_tx_find_w(unsigned char s_target)
+{
+    return (unsigned long)find_minimal_w(s_target);
+}
+
+/* Encode and latch one symbol; the latch goes to sim_latch_hook */
+unsigned long sim_tx_process(unsigned char symbol)
+{
+    process_nibble(symbol);
+    
+    return (unsigned long)current_bus_state;
+}
+
+unsigned char sim_tx_syndrome(unsigned long state)
+{
+    return compute_syndrome_from_bus((bus_state_t)state);
+}
+
+/* UART_ISR push (no overrun: the caller sizes frames to fit) */
+static void fifo_push(uint8_t value)
+{
+    rx_fifo[rx_fifo_head] = value;
+    rx_fifo_head = (rx_fifo_head + 1) & RX_FIFO_MASK;
+}
+
+/* Main loop: hand every queued byte to tx_handler() */
+static void fifo_drain(void)
+{
+    uint8_t rx_char;
+    
+    while (rx_fifo_tail != rx_fifo_head)
+    {
+        RX_FIFO_POP(rx_char);
+        tx_handler(rx_char);
+#if TX_CREDIT_ENABLE
+        credit_report();
+#endif
+    }
+}
+
+/* sim_tx_send_frame
+ * Queues CTRL_BURST, len, data as UART_ISR would, then drains the FIFO the
+ * way the main loop does. len must not exceed sim_tx_frame_max().
+ */
+void sim_tx_send_frame(const unsigned char *data, unsigned char len)
+{
+    uint8_t i;
+    
+    fifo_push(CTRL_BURST);
+    fifo_push(len);
+    for (i = 0; i < len; i++)
+    {
+        fifo_push(data[i]);
+    }
+    
+    fifo_drain();
+}
+
+/* sim_tx_resync
+ * Sends CTRL_RESYNC. Returns 0 (nothing sent) when TX_RESYNC_ENABLE is 0.
+ */
+unsigned char sim_tx_resync(void)
+{
+#if TX_RESYNC_ENABLE
+    fifo_push(CTRL_RESYNC);
+    fifo_drain();
+    
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+/* Timer1_ISR stand-in: one timer1_ticks count per SIGALRM */
+static void timer1_signal(int signum)
+{
+    (void)signum;
+    timer1_ticks++;
+}
+
+/* sim_tx_send_truncated
+ * Queues CTRL_BURST, len and only the first sent (< len) payload bytes,
+ * then drains the FIFO while SIGALRM advances timer1_ticks every
+ * millisecond, so tx_handler() can only return through the control
+ * sequence timeout. Returns the number of bytes left in rx_fifo.
+ */
+unsigned char sim_tx_send_truncated(const unsigned char *data, unsigned char len,
+                                    unsigned char sent)
+{
+    struct itimerval tick = { { 0, 1000 }, { 0, 1000 } };
+    struct itimerval stop = { { 0, 0 }, { 0, 0 } };
+    uint8_t i;
+    
+    fifo_push(CTRL_BURST);
+    fifo_push(len);
+    for (i = 0; i < sent; i++)
+    {
+        fifo_push(data[i]);
+    }
+    
+    signal(SIGALRM, timer1_signal);
+    setitimer(ITIMER_REAL, &tick, 0);
+    fifo_drain();
+    setitimer(ITIMER_REAL, &stop, 0);
+    signal(SIGALRM, SIG_DFL);
+    
+    return RX_FIFO_COUNT();
+}
+
+/* --- Benchmarks --- */
+
+#define BENCH_INPUTS    4096    /* Power of two */
+#define BENCH_MASK      (BENCH_INPUTS - 1)
+
+static uint8_t bench_symbol[BENCH_INPUTS];
+static uint8_t bench_char[BENCH_INPUTS];
+static bus_state_t bench_state[BENCH_INPUTS];
+static bit bench_ready = 0;
+
+volatile unsigned long sim_tx_sink;
+
+static void bench_prepare(void)
+{
+    unsigned int i;
+    
+    if (bench_ready)
+    {
+        return;
+    }
+    
+    for (i = 0; i < BENCH_INPUTS; i++)
+    {
+        bench_symbol[i] = (uint8_t)(sim_random() & SYNDROME_MASK);
+        bench_char[i] = (uint8_t)(0x20 + sim_random() % 0x5F);   /* Printable: never a control byte */
+        bench_state[i] = (bus_state_t)(sim_random() & BUS_STATE_MASK);
+    }
+    bench_ready = 1;
+}
+
+#define SYNDROME_CALL(k)  acc ^= compute_syndrome_from_bus(bench_state[(k) & BENCH_MASK])
+static void bench_syndrome(unsigned long iterations)
+{
+    unsigned long i;
+    uint8_t acc = 0;
+    
+    bench_prepare();
+    SIM_BENCH_LOOP(i, iterations, SYNDROME_CALL)
+    sim_tx_sink = acc;
+}
+
+/* Chained: each input depends on the last result, so the time is the
+ * latency of the call and not lost under the empty-call loop */
+#define FIND_W_CALL(k)  acc = find_minimal_w((uint8_t)(bench_symbol[(k) & BENCH_MASK] ^ (acc & 1)))
+static void bench_find_w(unsigned long iterations)
+{
+    unsigned long i;
+    bus_state_t acc = 0;
+    
+    bench_prepare();
+    SIM_BENCH_LOOP(i, iterations, FIND_W_CALL)
+    sim_tx_sink = acc;
+}
+
+#define ENCODE_CALL(k)  encode_nibble(bench_symbol[(k) & BENCH_MASK])
+static void bench_encode(unsigned long iterations)
+{
+    unsigned long i;
+    
+    bench_prepare();
+    SIM_BENCH_LOOP(i, iterations, ENCODE_CALL)
+    sim_tx_sink = current_bus_state;
+}
+
+#define PROCESS_CALL(k)  process_nibble(bench_symbol[(k) & BENCH_MASK])
+static void bench_process(unsigned long iterations)
+{
+    unsigned long i;
+    void (*hook)(unsigned long state);
+    
+    bench_prepare();
+    hook = sim_latch_hook;
+    sim_latch_hook = 0;
+    SIM_BENCH_LOOP(i, iterations, PROCESS_CALL)
+    sim_latch_hook = hook;
+    sim_tx_sink = current_bus_state;
+}
+
+/* One data character through tx_handler(): 8 / R symbols */
+#define HANDLER_CALL(k)  tx_handler(bench_char[(k) & BENCH_MASK])
+static void bench_handler(unsigned long iterations)
+{
+    unsigned long i;
+    void (*hook)(unsigned long state);
+    
+    bench_prepare();
+    hook = sim_latch_hook;
+    sim_latch_hook = 0;
+    SIM_BENCH_LOOP(i, iterations, HANDLER_CALL)
+    sim_latch_hook = hook;
+    sim_tx_sink = current_bus_state;
+}
+
+/* Same loop around an empty out-of-line call (subtracted by sim_main.c) */
+#define NOP_CALL(k)  sim_bench_nop(bench_symbol[(k) & BENCH_MASK])
+static void bench_overhead(unsigned long iterations)
+{
+    unsigned long i;
+    
+    bench_prepare();
+    SIM_BENCH_LOOP(i, iterations, NOP_CALL)
+}
+
+const sim_bench_t sim_tx_benches[] =
+{
+    { "(call overhead)",           bench_overhead },
+    { "compute_syndrome_from_bus", bench_syndrome },
+    { "find_minimal_w",            bench_find_w },
+    { "encode_nibble",             bench_encode },
+    { "process_nibble",            bench_process },
+    { "tx_handler (data char)",    bench_handler },
+};
+const unsigned char sim_tx_bench_count = sizeof(sim_tx_benches) / sizeof(sim_tx_benches[0]);
@@ -0,0 +1,43 @@
+/* File: stub/aduc841.h
+ * Host stand-in for the Keil C51 <aduc841.h>, used by the Simulation build
+ * only. The firmware sources compiled by the simulator (bus_encoder.c,
+ * tx_handler.c, Rx_decoder.c) include it unchanged.
+ *
+ * Keil memory-space keywords are dropped, bit becomes a byte.
+ * sbit declarations turn into constant 8051 bit addresses (P2^3 = 0xA3):
+ * the simulated modules never drive a pin, so a TU that does would fail
+ * to compile here instead of silently doing nothing.
+ * No __C51__ here, so the C51-only paths (ACC/P parity) use their portable
+ * fallback.
+ * SIM_PORT_REPLAY (Rx_input.c only): reading P0..P3 calls sim_port_read()
+ * in sim_rx.c, which replays a scripted sequence of port values.
+ */
+#ifndef SIM_ADUC841_H
+#define SIM_ADUC841_H
+
+#define idata
+#define xdata
+#define pdata
+#define code    const
+#define bit     unsigned char
+#define sbit    static const unsigned char
+
+#ifdef SIM_PORT_REPLAY
+unsigned char sim_port_read(unsigned char port);
+
+#define P0      sim_port_read(0)
+#define P1      sim_port_read(1)
+#define P2      sim_port_read(2)
+#define P3      sim_port_read(3)
+#else
+/* Port SFR byte addresses (bit-addressable) */
+enum
+{
+    P0 = 0x80,
+    P1 = 0x90,
+    P2 = 0xA0,
+    P3 = 0xB0
+};
+#endif
+
+#endif
@@ -0,0 +1,344 @@
+#!/usr/bin/env python3
+"""
+File: host_benchmark.py
+=============================================================================
+H1-Type Bus End-to-End Benchmark
+Streams a known symbol pattern into the Tx MCU, captures what the Rx MCU
+decodes, and reports throughput, loss and per-symbol latency.
+=============================================================================
+
+CHAIN UNDER TEST:
+-----------------
+    host -> Tx UART_ISR -> process_nibble -> 74HC595 -> Rx read_bus_raw
+         -> rx_decode_step -> Rx UART -> host
+
+SETUP:
+------
+- Tx MCU on TX_PORT, Rx MCU on RX_PORT (two serial adapters).
+- Rx built with RX_CAPTURE_POLL or RX_CAPTURE_STROBE. RX_CAPTURE_TIMER
+  reports every symbol once per tick and cannot be matched to the input.
+- Rx output RX_OUTPUT_ASCII ("<S>\\r\\n" per symbol) or RX_OUTPUT_BINARY
+  (framed characters, see host_receiver.py); select with --format.
+- HAMMING_R below must match both header.h files.
+
+PATTERNS:
+---------
+  all16   symbols 0, 1, ..., 2^R - 1, repeated
+  random  uniformly random symbols (includes repeats; a repeated symbol
+          does not change the bus, so POLL capture cannot see it)
+  worst   every symbol toggles a line, cycling through all N lines, so
+          every shift register output switches equally often
+
+Symbols are packed MSB-first into bytes, exactly as tx_handler() splits
+them, and sent with the credit flow control of host_sender.py.
+
+LATENCY:
+--------
+Measured from the host write that contained the symbol to the host read
+that returned its decoded value. It includes both USB-serial adapters and
+the Rx uplink, so compare runs on the same setup rather than treating the
+number as absolute.
+
+USAGE:
+------
+    python host_benchmark.py --pattern worst --count 4096
+"""
+
+import argparse
+import difflib
+import math
+import random
+import threading
+import time
+
+import serial
+
+import host_sender
+from host_receiver import FrameParser
+
+# =============================================================================
+# CONFIGURATION (User-Editable)
+# =============================================================================
+TX_PORT = 'COM5'        # Tx MCU (host_sender.PORT)
+RX_PORT = 'COM6'        # Rx MCU (host_receiver.PORT)
+TX_BAUDRATE = 9600
+RX_BAUDRATE = 9600
+HAMMING_R = 4
+DRAIN_S = 1.0           # Keep capturing this long after the last credit
+
+# =============================================================================
+# PATTERNS
+# =============================================================================
+
+def make_symbols(pattern, count, r=HAMMING_R, seed=1):
+    """
+    Generate count R-bit symbols for the named pattern.
+    """
+    n = (1 << r) - 1
+    if pattern == 'all16':
+        return [i & n for i in range(count)]
+    if pattern == 'random':
+        rng = random.Random(seed)
+        return [rng.randint(0, n) for _ in range(count)]
+    if pattern == 'worst':
+        # S ^= line toggles bus line 'line' (H column i = binary(i))
+        symbols = []
+        s = 0
+        for i in range(count):
+            s ^= (i % n) + 1
+            symbols.append(s)
+        return symbols
+    raise ValueError(f"unknown pattern '{pattern}'")
+
+
+def pack_symbols(symbols, r=HAMMING_R):
+    """
+    Pack R-bit symbols MSB-first into bytes (inverse of the Tx split).
+    Trailing symbols that do not fill a byte are dropped.
+
+    Returns:
+        (payload bytes, number of symbols actually packed)
+    """
+    out = bytearray()
+    acc = 0
+    bits = 0
+    used = 0
+    for i, s in enumerate(symbols):
+        acc = (acc << r) | s
+        bits += r
+        if bits >= 8:
+            bits -= 8
+            out.append((acc >> bits) & 0xFF)
+            acc &= (1 << bits) - 1
+            if bits == 0:
+                used = i + 1
+    # Keep only whole byte-aligned groups so the Tx carry ends empty
+    return bytes(out[:used * r // 8]), used
+
+
+def split_bytes(data, r=HAMMING_R):
+    """
+    Split bytes into R-bit symbols MSB-first (same as tx_handler()).
+    """
+    symbols = []
+    acc = 0
+    bits = 0
+    for b in data:
+        acc = (acc << 8) | b
+        bits += 8
+        while bits >= r:
+            bits -= r
+            symbols.append((acc >> bits) & ((1 << r) - 1))
+        acc &= (1 << bits) - 1
+    return symbols
+
+# =============================================================================
+# CAPTURE / SEND
+# =============================================================================
+
+class RxCapture(threading.Thread):
+    """
+    Background reader on the Rx port. Collects (time, symbol) pairs.
+    """
+
+    def __init__(self, ser, fmt):
+        super().__init__(daemon=True)
+        self.ser = ser
+        self.fmt = fmt
+        self.samples = []
+        self.stop = threading.Event()
+
+    def run(self):
+        parser = FrameParser()
+        line = bytearray()
+        mask = (1 << HAMMING_R) - 1
+        acc = 0
+        bits = 0
+        while not self.stop.is_set():
+            data = self.ser.read(self.ser.in_waiting or 1)
+            if not data:
+                continue
+            now = time.perf_counter()
+            if self.fmt == 'binary':
+                # Frames carry characters; split them back into symbols
+                # (carry across frames for R = 3)
+                for payload in parser.feed(data):
+                    for b in payload:
+                        acc = (acc << 8) | b
+                        bits += 8
+                        while bits >= HAMMING_R:
+                            bits -= HAMMING_R
+                            self.samples.append((now, (acc >> bits) & mask))
+                        acc &= (1 << bits) - 1
+                continue
+            for b in data:
+                if b == 0x0A:
+                    fields = line.split()
+                    line.clear()
+                    if fields and fields[0].isdigit():
+                        self.samples.append((now, int(fields[0])))
+                elif b != 0x0D:
+                    line.append(b)
+
+
+def send_with_credits(ser, wire, offsets, frame_len):
+    """
+    Credit-paced send (as host_sender.stream_to_mcu), recording the time
+    each payload byte was written.
+
+    Args:
+        ser: open Tx port
+        wire: framed bytes to send
+        offsets: wire offset of every payload byte
+        frame_len: only used for the error message
+
+    Returns:
+        List of write times per payload byte, or None on a stall.
+    """
+    ser.reset_input_buffer()
+    ser.write(bytes([host_sender.CTRL_CREDIT]))
+    reply = ser.read(2)
+    if len(reply) != 2 or reply[0] != host_sender.CTRL_CREDIT:
+        print("Tx MCU did not answer the credit request")
+        return None
+    window = credits = reply[1]
+
+    wire_times = [0.0] * len(wire)
+    buf = bytearray()
+    sent = 0
+    while sent < len(wire) or credits < window:
+        if credits > 0 and sent < len(wire):
+            n = min(credits, len(wire) - sent)
+            ser.write(wire[sent:sent + n])
+            now = time.perf_counter()
+            wire_times[sent:sent + n] = [now] * n
+            sent += n
+            credits -= n
+        got = host_sender._read_credits(ser, buf,
+                                        credits == 0 or sent >= len(wire))
+        if got is None:
+            print(f"Stalled after {sent} of {len(wire)} bytes "
+                  f"(frame length {frame_len})")
+            return None
+        credits += got
+    return [wire_times[o] for o in offsets]
+
+# =============================================================================
+# REPORT
+# =============================================================================
+
+def percentile(sorted_values, p):
+    """
+    Nearest-rank percentile of an already sorted list.
+    """
+    if not sorted_values:
+        return float('nan')
+    k = max(0, min(len(sorted_values) - 1,
+                   math.ceil(p / 100.0 * len(sorted_values)) - 1))
+    return sorted_values[k]
+
+
+def report(expected, send_times, samples, pattern):
+    """
+    Align the received symbols with the sent ones and print the results.
+    """
+    received = [s for _, s in samples]
+    matcher = difflib.SequenceMatcher(None, expected, received, autojunk=False)
+
+    latencies = []
+    last_rx = None
+    for block in matcher.get_matching_blocks():
+        for k in range(block.size):
+            i = block.a + k
+            j = block.b + k
+            latencies.append(samples[j][0] - send_times[i])
+            last_rx = samples[j][0]
+    matched = len(latencies)
+    latencies.sort()
+
+    lost = len(expected) - matched
+    extra = len(received) - matched
+    elapsed = (last_rx - send_times[0]) if last_rx else float('nan')
+
+    print("=" * 60)
+    print(f"Pattern: {pattern}, {len(expected)} symbols "
+          f"({len(expected) * HAMMING_R // 8} bytes)")
+    print(f"Received: {len(received)} symbols, matched {matched}")
+    print(f"Loss:     {lost} ({100.0 * lost / len(expected):.2f} %), "
+          f"unexpected {extra}")
+    if matched:
+        print(f"Throughput: {matched / elapsed:.1f} symbols/s "
+              f"({matched * HAMMING_R / 8 / elapsed:.1f} bytes/s)")
+        print("Latency (ms): " + ", ".join(
+            f"p{p} {1000 * percentile(latencies, p):.2f}"
+            for p in (50, 90, 99)) +
+            f", max {1000 * latencies[-1]:.2f}")
+    print("=" * 60)
+
+# =============================================================================
+# MAIN ENTRY POINT
+# =============================================================================
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.split('\n')[3])
+    ap.add_argument('--tx-port', default=TX_PORT)
+    ap.add_argument('--rx-port', default=RX_PORT)
+    ap.add_argument('--tx-baud', type=int, default=TX_BAUDRATE)
+    ap.add_argument('--rx-baud', type=int, default=RX_BAUDRATE)
+    ap.add_argument('--pattern', choices=('all16', 'random', 'worst'),
+                    default='all16')
+    ap.add_argument('--count', type=int, default=1024,
+                    help='number of symbols to send')
+    ap.add_argument('--format', choices=('ascii', 'binary'), default='ascii',
+                    help='Rx RX_OUTPUT_FORMAT')
+    ap.add_argument('--frame-len', type=int,
+                    default=host_sender.STREAM_FRAME_LEN,
+                    help='burst frame length, 0 = unframed')
+    ap.add_argument('--seed', type=int, default=1)
+    args = ap.parse_args()
+
+    symbols = make_symbols(args.pattern, args.count, seed=args.seed)
+    payload, used = pack_symbols(symbols)
+    symbols = symbols[:used]
+
+    # Wire layout: payload byte k sits at offsets[k]
+    if args.frame_len > 0:
+        wire = host_sender.frame_bursts(payload, args.frame_len)
+        flen = max(1, min(args.frame_len, 255))
+        offsets = [k + 2 * (k // flen + 1) for k in range(len(payload))]
+    else:
+        wire = payload
+        offsets = list(range(len(payload)))
+
+    try:
+        with serial.Serial(args.rx_port, args.rx_baud, timeout=0.1) as rx, \
+             serial.Serial(args.tx_port, args.tx_baud, timeout=2.0) as tx:
+            # Wait for connection stabilization
+            time.sleep(2)
+            rx.reset_input_buffer()
+
+            capture = RxCapture(rx, args.format)
+            capture.start()
+
+            byte_times = send_with_credits(tx, wire, offsets, args.frame_len)
+            time.sleep(DRAIN_S)
+            capture.stop.set()
+            capture.join()
+    except serial.SerialException as e:
+        print(f"[ERROR] Serial port error: {e}")
+        return 1
+
+    if byte_times is None:
+        return 1
+
+    # Each byte carries 8 / R symbols; a symbol is sent with its last bit
+    symbol_times = []
+    for i in range(len(symbols)):
+        symbol_times.append(byte_times[((i + 1) * HAMMING_R - 1) // 8])
+
+    report(symbols, symbol_times, capture.samples, args.pattern)
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,221 @@
+#!/usr/bin/env python3
+"""
+File: host_receiver.py
+=============================================================================
+H1-Type Bus Decoder Host Script
+Reads the receiver MCU's UART output and prints the recovered characters.
+=============================================================================
+
+INPUT FORMAT:
+-------------
+With RX_OUTPUT_FORMAT = RX_OUTPUT_BINARY (Rx header.h) the receiver packs
+the decoded R-bit symbols back into the original characters and sends them
+as frames:
+
+    RX_FRAME_SYNC, <len>, <len bytes> [, <CRC-8>]
+
+len is 1..RX_FRAME_MAX. The CRC-8 (poly 0x07, init 0x00) covers <len> and
+the payload. A payload byte may equal RX_FRAME_SYNC; the reader checks len
+and the CRC before accepting a frame and otherwise resyncs on the next
+sync byte.
+
+With RX_OUTPUT_ASCII the receiver sends one decimal symbol per line, which
+this script also accepts (--ascii) and reassembles the same way. An "R"
+line marks a Tx bus resync: the bits of an unfinished character are
+dropped, as the receiver does in binary mode. An "E" line is a sample the
+receiver dropped because the aux parity line (RX_AUX_PARITY) stayed odd;
+they are counted and reported on exit.
+
+USAGE:
+------
+    python host_receiver.py [--ascii]
+
+CONFIGURATION:
+--------------
+Edit the constants below to match the Rx header.h.
+"""
+
+import sys
+import serial
+
+# =============================================================================
+# CONFIGURATION (User-Editable)
+# =============================================================================
+PORT = 'COM6'       # Serial port of the receiver MCU
+BAUDRATE = 9600     # Must match UART_BAUD_INDEX in the Rx header.h
+
+HAMMING_R = 4           # Symbol width, must match both header.h files
+RX_FRAME_SYNC = 0x7E    # Must match the Rx header.h
+RX_FRAME_MAX = 8
+RX_FRAME_CRC = True
+
+# =============================================================================
+# FUNCTIONS
+# =============================================================================
+
+def crc8(data, crc=0x00):
+    """
+    CRC-8, poly 0x07, MSB-first (same as crc8_update() in rx_output.c).
+    """
+    for b in data:
+        crc ^= b
+        for _ in range(8):
+            if crc & 0x80:
+                crc = ((crc << 1) ^ 0x07) & 0xFF
+            else:
+                crc = (crc << 1) & 0xFF
+    return crc
+
+
+class FrameParser:
+    """
+    Incremental parser for the binary frame stream.
+
+    feed() takes any number of received bytes and returns the payloads of
+    all frames completed by them. Frames with a bad length or CRC are
+    counted in bad_frames and skipped.
+    """
+
+    def __init__(self, frame_max=RX_FRAME_MAX, use_crc=RX_FRAME_CRC):
+        self.frame_max = frame_max
+        self.use_crc = use_crc
+        self.buf = bytearray()
+        self.frames = 0
+        self.bad_frames = 0
+
+    def feed(self, data):
+        self.buf.extend(data)
+        payloads = []
+        trailer = 1 if self.use_crc else 0
+
+        while True:
+            start = self.buf.find(RX_FRAME_SYNC)
+            if start < 0:
+                self.buf.clear()
+                break
+            del self.buf[:start]
+
+            if len(self.buf) < 2:
+                break
+            length = self.buf[1]
+            if not 1 <= length <= self.frame_max:
+                self.bad_frames += 1
+                del self.buf[:1]
+                continue
+
+            total = 2 + length + trailer
+            if len(self.buf) < total:
+                break
+
+            payload = bytes(self.buf[2:2 + length])
+            if self.use_crc and crc8(self.buf[1:2 + length]) != self.buf[total - 1]:
+                self.bad_frames += 1
+                del self.buf[:1]
+                continue
+
+            del self.buf[:total]
+            self.frames += 1
+            payloads.append(payload)
+
+        return payloads
+
+
+class SymbolPacker:
+    """
+    Rebuild characters from decoded R-bit symbols, MSB-first
+    (host version of transmit_binary_symbol() for the ASCII output).
+    """
+
+    def __init__(self, r=HAMMING_R):
+        self.r = r
+        self.acc = 0
+        self.bits = 0
+
+    def reset(self):
+        self.acc = 0
+        self.bits = 0
+
+    def push(self, symbol):
+        self.acc = (self.acc << self.r) | (symbol & ((1 << self.r) - 1))
+        self.bits += self.r
+        if self.bits >= 8:
+            self.bits -= 8
+            byte = (self.acc >> self.bits) & 0xFF
+            self.acc &= (1 << self.bits) - 1
+            return bytes([byte])
+        return b''
+
+
+def read_binary(ser):
+    """
+    Print characters from binary frames until Ctrl+C.
+    """
+    parser = FrameParser()
+    total = 0
+    try:
+        while True:
+            data = ser.read(ser.in_waiting or 1)
+            for payload in parser.feed(data):
+                total += len(payload)
+                sys.stdout.write(payload.decode('latin-1'))
+                sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+    print(f"\n[{parser.frames} frames, {total} bytes, "
+          f"{parser.bad_frames} rejected]")
+
+
+def read_ascii(ser):
+    """
+    Print characters from "<S>\\r\\n" lines until Ctrl+C.
+    """
+    packer = SymbolPacker()
+    rejected = 0
+    try:
+        while True:
+            line = ser.readline().strip()
+            if not line:
+                continue
+            if line == b'R':
+                packer.reset()          # Tx resync
+                continue
+            if line == b'E':
+                rejected += 1           # Aux parity error, sample dropped
+                continue
+            try:
+                symbol = int(line.split()[0])
+            except ValueError:
+                continue
+            out = packer.push(symbol)
+            if out:
+                sys.stdout.write(out.decode('latin-1'))
+                sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+    print()
+    if rejected:
+        print(f"{rejected} sample(s) rejected by the aux parity check")
+
+
+# =============================================================================
+# MAIN ENTRY POINT
+# =============================================================================
+
+if __name__ == "__main__":
+    ascii_mode = '--ascii' in sys.argv[1:]
+
+    print("=" * 60)
+    print("H1-Type Bus Decoder - Host Receiver")
+    print(f"Port: {PORT}, Baud: {BAUDRATE}, "
+          f"Format: {'ASCII' if ascii_mode else 'binary frames'}")
+    print("Press Ctrl+C to exit.")
+    print("=" * 60)
+
+    try:
+        with serial.Serial(PORT, BAUDRATE, timeout=1) as ser:
+            if ascii_mode:
+                read_ascii(ser)
+            else:
+                read_binary(ser)
+    except serial.SerialException as e:
+        print(f"[ERROR] Serial port error: {e}")
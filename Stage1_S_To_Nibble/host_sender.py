@@ -8,7 +8,9 @@ Sends raw characters to ADuC841 via serial port.
 
 INPUT FORMAT:
 -------------
-This script sends raw 8-bit characters directly to the MCU.
+This script sends 8-bit characters to the MCU, wrapped in burst frames
+(BURST_LEN) so that every byte is data. Unframed, the bytes listed under
+"Reserved Byte Values" in the Tx header.h are commands, not characters.
 The MCU firmware splits each character into:
   - High nibble (bits 7..4) -> transmitted first
   - Low nibble (bits 3..0)  -> transmitted second
@@ -18,16 +20,28 @@ Each nibble becomes a 4-bit syndrome S_new for the H1 encoder.
 USAGE:
 ------
     python host_sender.py
+    python host_sender.py --stream <file>     ('-' reads stdin)
+    python host_sender.py --stats [--clear]   (TX_INSTRUMENT builds)
+    python host_sender.py --resync            (TX_RESYNC_ENABLE builds)
 
 Enter text when prompted. Press Enter to send.
 The script adds '\\n' as a batch terminator after your input.
 
+--stream sends the whole input over one open connection, paced by the
+MCU's FIFO credits (see "Credit Flow Control" in the Tx header.h) instead
+of fixed sleeps, and reports the achieved bytes/s.
+
+--resync sends CTRL_RESYNC: the Tx returns the bus to the all-zero state
+and the receiver restarts its character packing (see "Bus Resync" in the
+Tx header.h).
+
 CONFIGURATION:
 --------------
 Edit the PORT and BAUDRATE variables below to match your setup.
 """
 
 import serial
+import sys
 import time
 
 # =============================================================================
@@ -36,10 +50,123 @@ import time
 PORT = 'COM5'       # Serial port (Windows: 'COM5', Linux: '/dev/ttyUSB0')
 BAUDRATE = 9600     # Must match MCU configuration
 
+# Burst framing (see "Burst Mode" in the Tx header.h)
+# N > 0 sends each line as frames of CTRL_BURST, <len>, <len bytes> with
+# len <= N; inside a frame every byte is data. The MCU latches all symbols
+# of a frame back-to-back at a fixed cadence, 2 * len bus symbols per frame.
+# The default of 6 is TX_BURST_MAX_BYTES, one burst per frame.
+# 0 sends a plain byte stream, for firmware built without TX_BURST_ENABLE:
+# reserved bytes (RESERVED_BYTES) are then commands to the MCU.
+BURST_LEN = 6
+CTRL_BURST = 0x02   # Must match CTRL_BURST in header.h
+
+# Bytes the MCU takes as commands outside a frame ("Reserved Byte Values")
+RESERVED_BYTES = {0x02, 0x05, 0x0A, 0x0D, 0x12, 0x14, 0x16, 0x18}
+
+# Baud rate negotiation (see "Host Control Bytes" in the Tx header.h)
+# With NEGOTIATE_BAUD set, the script starts at BAUDRATE and steps to the
+# fastest entry of BAUD_TABLE that the MCU acknowledges at both rates.
+NEGOTIATE_BAUD = False
+BAUD_TABLE = [9600, 19200, 38400, 57600, 115200, 230400]   # index = BAUD_xxx
+CTRL_BAUD = 0x16    # Must match header.h
+CTRL_ACK = 0x06
+CTRL_NAK = 0x15
+BAUD_CONFIRM_S = 1.0    # MCU fallback timeout, BAUD_CONFIRM_MS / 1000
+
+# Streaming (see "Credit Flow Control" in the Tx header.h)
+# The data is wrapped in burst frames of up to STREAM_FRAME_LEN bytes, so
+# every byte is data (control codes and '\n' inside files are safe).
+CTRL_CREDIT = 0x12          # Must match header.h
+STREAM_FRAME_LEN = 255      # 1..255, 0 = unframed byte stream
+STREAM_TIMEOUT_S = 2.0      # No credit for this long = link stalled
+
+# Statistics query (TX_INSTRUMENT, see "Hot-Path Instrumentation" in header.h)
+CTRL_STATS = 0x05           # Must match header.h
+STAT_NAMES = ['syndrome', 'find_w', 'output', 'handoff', 'wake']
+TIMER_US = 1 / 11.0592      # One Timer 0 count (core cycle) in microseconds
+
+# Bus resync (TX_RESYNC_ENABLE, see "Bus Resync" in header.h)
+CTRL_RESYNC = 0x18          # Must match header.h
+
 # =============================================================================
 # FUNCTIONS
 # =============================================================================
 
+def frame_bursts(payload, burst_len=BURST_LEN):
+    """
+    Wrap payload bytes into burst frames: CTRL_BURST, <len>, <len bytes>.
+    
+    Args:
+        payload: bytes to send
+        burst_len: maximum payload bytes per frame (1..255)
+    
+    Returns:
+        The framed byte string.
+    """
+    burst_len = max(1, min(burst_len, 255))
+    framed = bytearray()
+    for i in range(0, len(payload), burst_len):
+        chunk = payload[i:i + burst_len]
+        framed += bytes([CTRL_BURST, len(chunk)]) + chunk
+    return bytes(framed)
+
+def _baud_exchange(ser, index):
+    """
+    Send CTRL_BAUD, index and wait for CTRL_ACK, index at the port's rate.
+    
+    Returns:
+        True if the MCU acknowledged this index.
+    """
+    ser.reset_input_buffer()
+    ser.write(bytes([CTRL_BAUD, index]))
+    reply = ser.read(2)
+    return reply == bytes([CTRL_ACK, index])
+
+
+def negotiate_baud(ser, max_baudrate=BAUD_TABLE[-1]):
+    """
+    Step the link to the fastest rate in BAUD_TABLE that works, on an open port.
+    
+    For each candidate, fastest first:
+    1. Request it at the current rate and wait for the ACK
+    2. Switch the host port and repeat the request as confirmation
+    3. If the confirmation is not acknowledged, wait for the MCU to fall
+       back to its default rate and try the next slower entry
+    
+    Args:
+        ser: open serial.Serial at the MCU's current rate
+        max_baudrate: do not try rates above this
+    
+    Returns:
+        The baud rate the link ended up at.
+    """
+    start_rate = ser.baudrate
+    candidates = [i for i, rate in enumerate(BAUD_TABLE)
+                  if start_rate < rate <= max_baudrate]
+    
+    for index in reversed(candidates):
+        rate = BAUD_TABLE[index]
+        print(f"  Trying {rate} baud...")
+        
+        if not _baud_exchange(ser, index):
+            print("    MCU did not acknowledge the request")
+            continue
+        
+        ser.baudrate = rate
+        time.sleep(0.05)
+        if _baud_exchange(ser, index):
+            print(f"    Link confirmed at {rate} baud")
+            return rate
+        
+        # No confirmation: MCU returns to its default rate on its own
+        print("    No confirmation at the new rate, falling back")
+        time.sleep(BAUD_CONFIRM_S + 0.2)
+        ser.baudrate = start_rate
+    
+    print(f"  Staying at {start_rate} baud")
+    return start_rate
+
+
 def send_string_to_mcu(text, port=PORT, baudrate=BAUDRATE):
     """
     Send a string of characters to the MCU.
@@ -52,7 +179,7 @@ def send_string_to_mcu(text, port=PORT, baudrate=BAUDRATE):
     Args:
         text: String to send (will be encoded to UTF-8 bytes)
         port: Serial port name
-        baudrate: Baud rate (should be 9600)
+        baudrate: Baud rate (BAUDRATE, or the result of negotiate_baud)
     """
     try:
         print(f"Connecting to {port} at {baudrate} baud...")
@@ -61,21 +188,36 @@ def send_string_to_mcu(text, port=PORT, baudrate=BAUDRATE):
         # Wait for connection stabilization
         time.sleep(2)
         
-        # Send each character
         print(f"Sending: '{text}'")
-        for i, char in enumerate(text):
-            byte_val = ord(char)
-            high_nibble = (byte_val >> 4) & 0x0F
-            low_nibble = byte_val & 0x0F
-            
-            print(f"  Char '{char}' (0x{byte_val:02X}): "
-                  f"High=0x{high_nibble:X}, Low=0x{low_nibble:X}")
-            
-            # Send the raw byte
-            ser.write(bytes([byte_val]))
-            
-            # Small delay between characters for MCU processing
-            time.sleep(0.01)
+        
+        # Burst mode: whole line in framed bursts, no per-character pacing
+        if BURST_LEN > 0:
+            payload = bytes(ord(char) & 0xFF for char in text)
+            ser.write(frame_bursts(payload, BURST_LEN))
+            frames = (len(payload) + BURST_LEN - 1) // BURST_LEN
+            print(f"  {len(payload)} bytes in {frames} burst frame(s) of "
+                  f"up to {BURST_LEN} bytes ({2 * BURST_LEN} symbols)")
+        
+        # Send each character
+        else:
+            reserved = sorted({ord(c) & 0xFF for c in text} & RESERVED_BYTES)
+            if reserved:
+                print("  Warning: unframed reserved byte(s) "
+                      + ", ".join(f"0x{b:02X}" for b in reserved)
+                      + " are commands to the MCU, not data")
+            for i, char in enumerate(text):
+                byte_val = ord(char)
+                high_nibble = (byte_val >> 4) & 0x0F
+                low_nibble = byte_val & 0x0F
+                
+                print(f"  Char '{char}' (0x{byte_val:02X}): "
+                      f"High=0x{high_nibble:X}, Low=0x{low_nibble:X}")
+                
+                # Send the raw byte
+                ser.write(bytes([byte_val]))
+                
+                # Small delay between characters for MCU processing
+                time.sleep(0.01)
         
         # Send terminator
         ser.write(b'\\n')
@@ -87,6 +229,168 @@ def send_string_to_mcu(text, port=PORT, baudrate=BAUDRATE):
     except serial.SerialException as e:
         print(f"Serial port error: {e}")
 
+def _read_credits(ser, buf, block):
+    """
+    Collect CTRL_CREDIT, <n> reports from the MCU.
+    
+    Args:
+        ser: open serial.Serial
+        buf: bytearray with bytes of an incomplete report from the last call
+        block: wait (up to the port timeout) for at least one report
+    
+    Returns:
+        Total credits received, or None if block was set and nothing came.
+    """
+    data = ser.read(max(ser.in_waiting, 2 if block else 0))
+    if block and not data:
+        return None
+    buf += data
+    
+    credits = 0
+    while len(buf) >= 2:
+        if buf[0] != CTRL_CREDIT:
+            del buf[:1]             # Not a report (e.g. stale reply byte)
+            continue
+        credits += buf[1]
+        del buf[:2]
+    return credits
+
+
+def stream_on_port(ser, data, frame_len=STREAM_FRAME_LEN):
+    """
+    Credit-paced send of a block of bytes on an already open port.
+    
+    1. Request the initial credit (free FIFO space)
+    2. Write as many bytes at once as there are credits
+    3. Add the credits the MCU returns as it drains its FIFO
+    4. Finish when all bytes are sent and all credits are back
+    
+    Args:
+        ser: open serial.Serial at the MCU's current rate, with a timeout
+        data: bytes to send
+        frame_len: burst frame size (STREAM_FRAME_LEN), 0 for raw bytes
+    
+    Returns:
+        Seconds from the first write until the MCU consumed everything,
+        or None on failure.
+    """
+    wire = frame_bursts(data, frame_len) if frame_len > 0 else bytes(data)
+    
+    ser.reset_input_buffer()
+    ser.write(bytes([CTRL_CREDIT]))
+    reply = ser.read(2)
+    if len(reply) != 2 or reply[0] != CTRL_CREDIT:
+        print("MCU did not answer the credit request")
+        return None
+    window = credits = reply[1]
+    print(f"Streaming {len(data)} bytes ({len(wire)} on the wire) "
+          f"at {ser.baudrate} baud, window {window} bytes")
+    
+    buf = bytearray()
+    sent = 0
+    start = time.perf_counter()
+    
+    while sent < len(wire) or credits < window:
+        if credits > 0 and sent < len(wire):
+            n = min(credits, len(wire) - sent)
+            ser.write(wire[sent:sent + n])
+            sent += n
+            credits -= n
+        
+        # Block only when nothing else can be done
+        got = _read_credits(ser, buf, credits == 0 or sent >= len(wire))
+        if got is None:
+            print(f"Stalled: no credit for {ser.timeout} s "
+                  f"({sent} of {len(wire)} bytes sent)")
+            return None
+        credits += got
+    
+    return time.perf_counter() - start
+
+
+def stream_to_mcu(data, port=PORT, baudrate=BAUDRATE,
+                  frame_len=STREAM_FRAME_LEN):
+    """
+    Send a block of bytes over one persistent connection with credit flow control.
+    
+    Opens the port once, optionally negotiates the baud rate, and sends
+    everything with stream_on_port().
+    
+    Args:
+        data: bytes to send
+        port: Serial port name
+        baudrate: Baud rate at which the MCU currently listens
+        frame_len: burst frame size (STREAM_FRAME_LEN), 0 for raw bytes
+    
+    Returns:
+        Achieved payload throughput in bytes/s, or None on failure.
+    """
+    try:
+        with serial.Serial(port, baudrate, timeout=STREAM_TIMEOUT_S) as ser:
+            # Wait for connection stabilization (once per session)
+            time.sleep(2)
+            ser.reset_input_buffer()
+            
+            if NEGOTIATE_BAUD:
+                negotiate_baud(ser)
+            
+            elapsed = stream_on_port(ser, data, frame_len)
+    
+    except serial.SerialException as e:
+        print(f"Serial port error: {e}")
+        return None
+    
+    if elapsed is None:
+        return None
+    
+    rate = len(data) / elapsed if elapsed > 0 else float('inf')
+    print(f"Done: {len(data)} bytes in {elapsed:.3f} s = {rate:.0f} bytes/s")
+    return rate
+
+def query_stats(ser, clear=False):
+    """
+    Ask a TX_INSTRUMENT build for its stage timings and print them.
+    
+    Args:
+        ser: open serial.Serial at the MCU's current rate
+        clear: reset the MCU statistics after the dump
+    
+    Returns:
+        Dict of stage name -> (count, min, max, avg) in Timer 0 counts,
+        or None if the MCU did not answer.
+    """
+    ser.reset_input_buffer()
+    ser.write(bytes([CTRL_STATS, 1 if clear else 0]))
+    head = ser.read(2)
+    if len(head) != 2 or head[0] != CTRL_STATS:
+        print("No statistics reply (firmware built without TX_INSTRUMENT?)")
+        return None
+    body = ser.read(head[1])
+    if len(body) != head[1]:
+        print("Statistics reply truncated")
+        return None
+    
+    overhead = (body[0] << 8) | body[1]
+    irq_latency = (body[4] << 8) | body[5]
+    print(f"Timestamp overhead: {overhead} counts, "
+          f"FIFO overruns: {body[2]}, FIFO peak: {body[3]}")
+    print(f"Max interrupt latency: {irq_latency} counts "
+          f"({irq_latency * TIMER_US:.1f} us)")
+    print(f"{'Stage':<10} {'Count':>6} {'Min':>6} {'Max':>6} {'Avg':>8} "
+          f"{'Avg us':>8}")
+    
+    stats = {}
+    for i, name in enumerate(STAT_NAMES):
+        rec = body[6 + 10 * i:16 + 10 * i]
+        count, smin, smax = [(rec[k] << 8) | rec[k + 1] for k in (0, 2, 4)]
+        total = int.from_bytes(rec[6:10], 'big')
+        avg = total / count if count else 0.0
+        stats[name] = (count, smin if count else 0, smax, avg)
+        print(f"{name:<10} {count:>6} {stats[name][1]:>6} {smax:>6} "
+              f"{avg:>8.1f} {avg * TIMER_US:>8.1f}")
+    return stats
+
+
 def interactive_mode():
     """
     Interactive mode: repeatedly prompt user for input and send to MCU.
@@ -95,13 +399,24 @@ def interactive_mode():
     print("H1-Type Bus Encoder Host Script")
     print("="*60)
     print(f"Port: {PORT}, Baudrate: {BAUDRATE}")
+    
+    baudrate = BAUDRATE
+    if NEGOTIATE_BAUD:
+        print("Negotiating baud rate...")
+        try:
+            with serial.Serial(PORT, BAUDRATE, timeout=0.5) as ser:
+                time.sleep(2)
+                baudrate = negotiate_baud(ser)
+        except serial.SerialException as e:
+            print(f"Serial port error: {e}")
+    
     print("Enter text to send. Press Ctrl+C to exit.\\n")
     
     try:
         while True:
             user_input = input("Enter text: ")
             if user_input:
-                send_string_to_mcu(user_input)
+                send_string_to_mcu(user_input, baudrate=baudrate)
                 print()
     except KeyboardInterrupt:
         print("\\nExiting.")
@@ -135,6 +450,31 @@ def demonstrate_nibble_split():
 # =============================================================================
 
 if __name__ == "__main__":
+    # Streaming mode: python host_sender.py --stream <file | ->
+    if len(sys.argv) == 3 and sys.argv[1] == '--stream':
+        if sys.argv[2] == '-':
+            payload = sys.stdin.buffer.read()
+        else:
+            with open(sys.argv[2], 'rb') as f:
+                payload = f.read()
+        sys.exit(0 if stream_to_mcu(payload) is not None else 1)
+    
+    # Statistics query: python host_sender.py --stats [--clear]
+    if len(sys.argv) >= 2 and sys.argv[1] == '--stats':
+        with serial.Serial(PORT, BAUDRATE, timeout=1) as ser:
+            time.sleep(2)
+            ok = query_stats(ser, clear='--clear' in sys.argv[2:])
+        sys.exit(0 if ok is not None else 1)
+    
+    # Bus resync: python host_sender.py --resync
+    if len(sys.argv) == 2 and sys.argv[1] == '--resync':
+        with serial.Serial(PORT, BAUDRATE, timeout=1) as ser:
+            time.sleep(2)
+            ser.write(bytes([CTRL_RESYNC]))
+            ser.flush()
+        print("Resync sent")
+        sys.exit(0)
+    
     # Show nibble split demonstration
     demonstrate_nibble_split()
     
@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+"""
+File: host_toggle_report.py
+=============================================================================
+H1-Type Bus Switching-Activity Report
+Measures bus line transitions per symbol on the Tx MCU and compares them
+with a naive parallel output of the same data.
+=============================================================================
+
+METHOD:
+-------
+1. Return the bus to S = 0 (host_sender.CTRL_RESYNC, see "Bus Resync" in
+   the Tx header.h), so the model starts from the state the Tx is in
+2. Clear the Tx toggle counters (CTRL_TOGGLES, 1); the resync toggles are
+   not counted
+3. Stream the input with credit flow control (host_sender.stream_on_port)
+4. Read the counters (CTRL_TOGGLES, 0), see "Switching-Activity Counters"
+   in the Tx header.h
+
+Baseline: the same R-bit symbols driven directly onto R parallel lines,
+where a symbol costs popcount(S_prev ^ S_new) transitions (up to R).
+The H1 encoder toggles line S_prev ^ S_new instead: at most one
+transition per symbol, none for a repeated symbol.
+
+The expected H1 count is also computed from the data; a mismatch with the
+measured count means symbols were lost.
+
+Requires a Tx build with TX_TOGGLE_STATS = 1 and TX_RESYNC_ENABLE = 1.
+
+USAGE:
+------
+    python host_toggle_report.py [file]     (default: built-in sample text)
+"""
+
+import sys
+import time
+
+import serial
+
+import host_sender
+
+# =============================================================================
+# CONFIGURATION (User-Editable)
+# =============================================================================
+PORT = host_sender.PORT
+BAUDRATE = host_sender.BAUDRATE
+HAMMING_R = 4               # Must match the Tx header.h
+LANES = 1                   # Tx TX_LANES: 2 = high nibble on lane A, low on B
+CTRL_TOGGLES = 0x14         # Must match the Tx header.h
+
+SAMPLE_TEXT = (b"The quick brown fox jumps over the lazy dog. "
+               b"Lowercase ASCII text repeats the high nibble 0x6/0x7 "
+               b"for most characters.\n") * 8
+
+# =============================================================================
+# FUNCTIONS
+# =============================================================================
+
+def split_symbols(data, r=HAMMING_R):
+    """
+    Split bytes into R-bit symbols MSB-first (same as tx_handler()).
+    """
+    symbols = []
+    acc = 0
+    bits = 0
+    for b in data:
+        acc = (acc << 8) | b
+        bits += 8
+        while bits >= r:
+            bits -= r
+            symbols.append((acc >> bits) & ((1 << r) - 1))
+        acc &= (1 << bits) - 1
+    return symbols
+
+
+def model_toggles(symbols):
+    """
+    Transitions for the H1 encoder and for a parallel R-line bus, both
+    starting from the all-zero state. With LANES = 2 the symbols alternate
+    between the two buses, each with its own previous symbol; the
+    per-line counts add up both lanes, as on the MCU.
+
+    Returns:
+        (h1_total, parallel_total, h1 transitions per line index 1..N)
+    """
+    n = (1 << HAMMING_R) - 1
+    per_line = [0] * (n + 1)
+    h1 = 0
+    parallel = 0
+    prev = [0] * LANES
+    for i, s in enumerate(symbols):
+        diff = prev[i % LANES] ^ s
+        if diff:
+            h1 += 1
+            per_line[diff] += 1
+        parallel += bin(diff).count('1')
+        prev[i % LANES] = s
+    return h1, parallel, per_line[1:]
+
+
+def read_toggles(ser, clear=False):
+    """
+    Send CTRL_TOGGLES, <clear> and parse the reply.
+
+    Returns:
+        (symbols, total, [per-line counts]) or None.
+    """
+    n = (1 << HAMMING_R) - 1
+    ser.reset_input_buffer()
+    ser.write(bytes([CTRL_TOGGLES, 1 if clear else 0]))
+    head = ser.read(2)
+    if len(head) != 2 or head[0] != CTRL_TOGGLES or head[1] != 8 + 2 * n:
+        print("No toggle counter reply (TX_TOGGLE_STATS off or HAMMING_R differs?)")
+        return None
+    body = ser.read(head[1])
+    if len(body) != head[1]:
+        print("Toggle counter reply truncated")
+        return None
+    symbols = int.from_bytes(body[0:4], 'big')
+    total = int.from_bytes(body[4:8], 'big')
+    lines = [int.from_bytes(body[8 + 2 * i:10 + 2 * i], 'big')
+             for i in range(n)]
+    return symbols, total, lines
+
+
+def report(data, measured):
+    """
+    Print the measured activity next to the model and the parallel baseline.
+    """
+    symbols = split_symbols(data)
+    h1, parallel, model_lines = model_toggles(symbols)
+    m_symbols, m_total, m_lines = measured
+
+    print("=" * 60)
+    print(f"Payload: {len(data)} bytes, {len(symbols)} symbols "
+          f"(MCU counted {m_symbols})")
+    if m_symbols:
+        print(f"H1 measured:        {m_total:>8} transitions, "
+              f"{m_total / m_symbols:.3f} per symbol")
+    print(f"H1 expected:        {h1:>8} transitions, "
+          f"{h1 / max(1, len(symbols)):.3f} per symbol")
+    print(f"Parallel ({HAMMING_R * LANES} lines): {parallel:>8} transitions, "
+          f"{parallel / max(1, len(symbols)):.3f} per symbol")
+    if parallel:
+        print(f"Reduction vs parallel: {100.0 * (1 - m_total / parallel):.1f} %")
+    if m_total != h1 or m_symbols != len(symbols):
+        print("WARNING: measured counts differ from the model")
+
+    print("-" * 60)
+    print(f"{'Line':>4} {'Measured':>9} {'Expected':>9}")
+    for i, (m, e) in enumerate(zip(m_lines, model_lines)):
+        print(f"{i + 1:>4} {m:>9} {e:>9}")
+    print("=" * 60)
+
+
+# =============================================================================
+# MAIN ENTRY POINT
+# =============================================================================
+
+if __name__ == "__main__":
+    if len(sys.argv) > 1:
+        with open(sys.argv[1], 'rb') as f:
+            payload = f.read()
+    else:
+        payload = SAMPLE_TEXT
+
+    try:
+        with serial.Serial(PORT, BAUDRATE,
+                           timeout=host_sender.STREAM_TIMEOUT_S) as ser:
+            # Wait for connection stabilization
+            time.sleep(2)
+            ser.write(bytes([host_sender.CTRL_RESYNC]))
+            if read_toggles(ser, clear=True) is None:
+                sys.exit(1)
+            if host_sender.stream_on_port(ser, payload) is None:
+                sys.exit(1)
+            measured = read_toggles(ser)
+    except serial.SerialException as e:
+        print(f"[ERROR] Serial port error: {e}")
+        sys.exit(1)
+
+    if measured is None:
+        sys.exit(1)
+    report(payload, measured)
@@ -5,30 +5,109 @@
 #include <aduc841.h>
 #include "header.h"
 
+#if (SYNDROME_KERNEL == SYNDROME_KERNEL_PARITY) || TX_AUX_PARITY
+/* parity8
+ * Even/odd parity of one byte: 1 if an odd number of bits is set.
+ * C51: loading ACC updates the PSW parity flag P in hardware.
+ */
+static uint8_t parity8(uint8_t value)
+{
+#ifdef __C51__
+    ACC = value;
+    return P;
+#else
+    value ^= value >> 4;
+    value ^= value >> 2;
+    value ^= value >> 1;
+    return value & 0x01;
+#endif
+}
+
+/* parity_state
+ * Parity of a bus_state_t: XOR its bytes into one (byte moves on the
+ * 8051, no bit loop), then parity8().
+ */
+static uint8_t parity_state(bus_state_t value)
+{
+#if (HAMMING_R == 5)
+    return parity8((uint8_t)(value ^ (value >> 8) ^ (value >> 16) ^ (value >> 24)));
+#elif (HAMMING_R == 4)
+    return parity8((uint8_t)(value ^ (value >> 8)));
+#else
+    return parity8((uint8_t)value);
+#endif
+}
+#endif
+
+#if TX_AUX_PARITY
+/* bus_parity
+ * Parity of the N bus lines: the value of the aux line (TX_AUX_PARITY),
+ * so that lines plus aux line hold an even number of ones.
+ */
+uint8_t bus_parity(bus_state_t bus_state)
+{
+    return parity_state(bus_state & BUS_STATE_MASK);
+}
+#endif
+
+#if (SYNDROME_KERNEL == SYNDROME_KERNEL_PARITY)
+/* compute_syndrome_from_bus
+ * Computes S = H * x^T with one masked parity per syndrome bit.
+ *
+ * The H1-type matrix column i (1-indexed) equals i in binary, so row k of
+ * H has a 1 in every column whose index has bit k set. Bus bit j is
+ * column j+1, which gives the fixed masks H1_COL_MASKk (header.h).
+ * Syndrome bit k = parity(x & H1_COL_MASKk): same result as XOR-ing the
+ * indices of all set bits, in constant time and without branches.
+ *
+ * No lookup tables. No stored matrix.
+ */
+uint8_t compute_syndrome_from_bus(bus_state_t bus_state)
+{
+    uint8_t syndrome;
+    
+    syndrome  = parity_state(bus_state & H1_COL_MASK0);
+    syndrome |= parity_state(bus_state & H1_COL_MASK1) << 1;
+#if (HAMMING_R >= 3)
+    syndrome |= parity_state(bus_state & H1_COL_MASK2) << 2;
+#endif
+#if (HAMMING_R >= 4)
+    syndrome |= parity_state(bus_state & H1_COL_MASK3) << 3;
+#endif
+#if (HAMMING_R >= 5)
+    syndrome |= parity_state(bus_state & H1_COL_MASK4) << 4;
+#endif
+    
+    return syndrome;
+}
+
+#else /* SYNDROME_KERNEL_LOOP */
+
 /* compute_syndrome_from_bus
  * Computes S = H * x^T on-the-fly using bitwise XOR.
  *
  * The H1-type matrix column i (1-indexed) equals i in binary.
  * So: syndrome = XOR of all column indices (j+1) for bits j that are set in x.
  *
- * Implementation: Loop through bits 0..14 of bus_state. For each set bit at
- * position j, XOR the syndrome with (j+1).
+ * Implementation: Loop through bits 0..N-1 of bus_state. For each set bit at
+ * position j, XOR the syndrome with (j+1). The loop bound HAMMING_N and the
+ * width of bus_state_t are compile-time constants of the selected HAMMING_R.
  *
  * No lookup tables. No stored matrix.
  */
-uint8_t compute_syndrome_from_bus(uint16_t bus_state)
+uint8_t compute_syndrome_from_bus(bus_state_t bus_state)
 {
     uint8_t syndrome = 0;
     uint8_t col_idx;
-    uint16_t temp_state;
+    bus_state_t temp_state;
     
-    /* Mask to only use bits 0..14 */
+    /* Mask to only use bits 0..N-1 */
     temp_state = bus_state & BUS_STATE_MASK;
     
     /* 
-     * Iterate through bit positions 0..14.
+     * Iterate through bit positions 0..N-1.
      * If bit j is set, XOR in column index (j+1).
-     * Column index (j+1) is just the 4-bit binary representation of (j+1).
+     * Column index (j+1) is just the R-bit binary representation of (j+1).
      */
     for (col_idx = 1; col_idx <= HAMMING_N; col_idx++)
     {
@@ -45,17 +124,19 @@ uint8_t compute_syndrome_from_bus(uint16_t bus_state)
     return syndrome;
 }
 
+#endif /* SYNDROME_KERNEL */
+
 /* find_minimal_w
- * Finds the minimal Hamming-weight 15-bit vector w such that H * w^T == s_target.
+ * Finds the minimal Hamming-weight N-bit vector w such that H * w^T == s_target.
  *
  * Algorithm: Exploit H1-type matrix structure (bounded search, actually O(1)).
  *
  * Key insight: In an H1-type matrix, column i equals the binary value i.
- * Therefore, to produce syndrome s_target (where 1 <= s_target <= 15),
+ * Therefore, to produce syndrome s_target (where 1 <= s_target <= N),
  * we simply need to set bit (s_target - 1), which contributes column s_target.
  *
  * Weight-0: s_target = 0 => w = 0
- * Weight-1: s_target in {1..15} => w = (1 << (s_target - 1))
+ * Weight-1: s_target in {1..N} => w = (1 << (s_target - 1))
  *
  * This is provably minimal because:
  * - Zero syndrome requires zero changes (trivially minimal).
@@ -65,10 +146,10 @@ uint8_t compute_syndrome_from_bus(uint16_t bus_state)
  * Determinism: Unique solution for each syndrome. No tie-breaking needed.
  * Smallest numeric w is achieved naturally since there's only one weight-1 solution.
  */
-uint16_t find_minimal_w(uint8_t s_target)
+bus_state_t find_minimal_w(uint8_t s_target)
 {
-    /* Mask to 4 bits (just in case) */
-    s_target &= 0x0F;
+    /* Mask to R bits (just in case) */
+    s_target &= SYNDROME_MASK;
     
     /* Zero syndrome => no change needed */
     if (s_target == 0)
@@ -77,53 +158,165 @@ uint16_t find_minimal_w(uint8_t s_target)
     }
     
     /*
-     * Nonzero syndrome s_target in {1..15}:
+     * Nonzero syndrome s_target in {1..N}:
      * The minimal-weight solution is to flip exactly the bit at position (s_target - 1).
      * This sets w to have a single '1' at bit position (s_target - 1).
      *
      * H * w^T = column s_target = s_target (by H1-type definition).
      */
-    return ((uint16_t)1 << (s_target - 1));
+    return ((bus_state_t)1 << (s_target - 1));
 }
 
-/* process_nibble
- * Core stateful encoder function. Processes one 4-bit syndrome S_new.
+/* encode_nibble
+ * Core stateful encoder function. Processes one R-bit syndrome S_new.
  *
  * Steps:
- * 1. Compute S_old = H * current_bus_state^T (on-the-fly)
+ * 1. S_old = current_syndrome (cached H * current_bus_state^T)
  * 2. Compute S_target = S_new XOR S_old (modulo-2 arithmetic)
  * 3. Find minimal-weight w such that H * w^T = S_target
  * 4. Update: current_bus_state ^= w (differential toggle)
- * 5. Output new bus state to shift registers
+ * 5. current_syndrome = S_new
+ *
+ * The caller outputs the new state (process_nibble() or a burst).
+ *
+ * Syndrome cache: H * (x ^ w)^T = S_old ^ S_target = S_new, so after the
+ * toggle the syndrome of the bus is exactly S_new. Keeping it in
+ * current_syndrome replaces the N-column scan of compute_syndrome_from_bus()
+ * with a single load. With ENCODER_DEBUG set, the cache is checked against
+ * the full recomputation; a mismatch is counted and the cache is repaired.
  *
  * CRITICAL: Uses XOR for syndrome arithmetic. Never OR or other operations.
  * CRITICAL: Does NOT overwrite current_bus_state directly from S_new.
  *           All updates go through differential toggling via w.
  */
-void process_nibble(uint8_t s_new)
+void encode_nibble(uint8_t s_new)
 {
     uint8_t s_old;
     uint8_t s_target;
-    uint16_t w;
+    bus_state_t w;
+#if TX_INSTRUMENT
+    uint16_t t_start;
+    
+    t_start = stamp_now();
+#endif
+    
+    /* Mask s_new to R bits */
+    s_new &= SYNDROME_MASK;
     
-    /* Mask s_new to 4 bits */
-    s_new &= 0x0F;
+    /* Step 1: S_old from the syndrome cache */
+    s_old = current_syndrome;
     
-    /* Step 1: Compute S_old from current bus state on-the-fly */
-    s_old = compute_syndrome_from_bus(current_bus_state);
+#if ENCODER_DEBUG
+    /* Debug: cache must match H * current_bus_state^T */
+    if (s_old != compute_syndrome_from_bus(current_bus_state))
+    {
+        if (syndrome_mismatch_count < 255)
+        {
+            syndrome_mismatch_count++;
+        }
+        s_old = compute_syndrome_from_bus(current_bus_state);
+    }
+#endif
     
     /* Step 2: Compute target syndrome using XOR (mod-2) */
     s_target = s_new ^ s_old;
     
+#if TX_INSTRUMENT
+    stat_record(STAT_SYNDROME, t_start);
+    t_start = stamp_now();
+#endif
+    
     /* Step 3: Find minimal-weight w */
     w = find_minimal_w(s_target);
     
+#if TX_INSTRUMENT
+    stat_record(STAT_FIND_W, t_start);
+#endif
+    
+#if TX_TOGGLE_STATS
+    /* Switching activity: w is 0 or the single line s_target */
+    toggle_symbols++;
+    if (s_target != 0)
+    {
+        toggle_total++;
+        toggle_line[s_target - 1]++;
+    }
+#endif
+    
     /* Step 4: Differential update (XOR, not overwrite!) */
     current_bus_state ^= w;
     
     /* Ensure we stay in valid range */
     current_bus_state &= BUS_STATE_MASK;
     
-    /* Step 5: Output to shift registers */
+    /* Step 5: New syndrome of the bus is S_new by construction */
+    current_syndrome = s_new;
+}
+
+#if (TX_LANES == 2)
+/* encode_nibble_b
+ * Steps 1-5 of encode_nibble() on lane B (current_bus_state_b,
+ * current_syndrome_b). The lanes are independent H1 buses: lane B's w
+ * depends only on lane B's previous syndrome.
+ *
+ * Not timed by TX_INSTRUMENT: its stages are the same code as lane A's.
+ */
+void encode_nibble_b(uint8_t s_new)
+{
+    uint8_t s_old;
+    uint8_t s_target;
+    
+    s_new &= SYNDROME_MASK;
+    s_old = current_syndrome_b;
+    
+#if ENCODER_DEBUG
+    if (s_old != compute_syndrome_from_bus(current_bus_state_b))
+    {
+        if (syndrome_mismatch_count < 255)
+        {
+            syndrome_mismatch_count++;
+        }
+        s_old = compute_syndrome_from_bus(current_bus_state_b);
+    }
+#endif
+    
+    s_target = s_new ^ s_old;
+    
+#if TX_TOGGLE_STATS
+    toggle_symbols++;
+    if (s_target != 0)
+    {
+        toggle_total++;
+        toggle_line[s_target - 1]++;
+    }
+#endif
+    
+    /* Differential update, same as lane A */
+    current_bus_state_b ^= find_minimal_w(s_target);
+    current_bus_state_b &= BUS_STATE_MASK;
+    current_syndrome_b = s_new;
+}
+#endif
+
+/* process_nibble
+ * Encodes one R-bit syndrome S_new (encode_nibble) and outputs the new bus
+ * state to the shift registers.
+ */
+void process_nibble(uint8_t s_new)
+{
+#if TX_INSTRUMENT
+    uint16_t t_start;
+#endif
+    
+    encode_nibble(s_new);
+    
+#if TX_INSTRUMENT
+    t_start = stamp_now();
+#endif
+    
     output_to_shift_registers();
+    
+#if TX_INSTRUMENT
+    stat_record(STAT_OUTPUT, t_start);
+#endif
 }
@@ -8,10 +8,253 @@
 typedef unsigned char uint8_t;
 typedef unsigned int  uint16_t;
 
-/*H1 Bus Encoder Constants */
+/*H1 Bus Encoder Constants (User-Editable: HAMMING_R only)
+ * Everything else is derived from HAMMING_R at compile time:
+ *   R = 2:  3 lines, 1 x 74HC595, 2 bits per bus transition
+ *   R = 3:  7 lines, 1 x 74HC595, 3 bits per bus transition
+ *   R = 4: 15 lines, 2 x 74HC595, 4 bits per bus transition (default)
+ *   R = 5: 31 lines, 4 x 74HC595, 5 bits per bus transition
+ */
 #define HAMMING_R       4                       /* Number of syndrome bits (m) */
-#define HAMMING_N       ((1 << HAMMING_R) - 1)  /* Bus width N = 2^R - 1 = 15 */
+#define HAMMING_N       ((1 << HAMMING_R) - 1)  /* Bus width N = 2^R - 1 */
+#define SYNDROME_MASK   ((1 << HAMMING_R) - 1)  /* Mask for an R-bit syndrome */
+
+/* Bus state type and mask: smallest type that holds N bits */
+#if (HAMMING_R == 2)
+typedef uint8_t bus_state_t;
+#define BUS_STATE_MASK  0x07                    /* Mask for bits 0..2 */
+#elif (HAMMING_R == 3)
+typedef uint8_t bus_state_t;
+#define BUS_STATE_MASK  0x7F                    /* Mask for bits 0..6 */
+#elif (HAMMING_R == 4)
+typedef uint16_t bus_state_t;
 #define BUS_STATE_MASK  0x7FFF                  /* Mask for bits 0..14 */
+#elif (HAMMING_R == 5)
+typedef unsigned long bus_state_t;
+#define BUS_STATE_MASK  0x7FFFFFFFUL            /* Mask for bits 0..30 */
+#else
+#error "HAMMING_R must be 2, 3, 4 or 5"
+#endif
+
+/* Highest bus line (column N), first bit out of the shift chain */
+#define BUS_STATE_MSB   ((bus_state_t)1 << (HAMMING_N - 1))
+
+/* Number of daisy-chained 74HC595 (8 outputs each) needed for N lines */
+#define SHIFT_CHAIN_CHIPS   ((HAMMING_N + 7) / 8)
+
+/* Debug build switch (User-Editable)
+ * 1: process_nibble() cross-checks the cached current_syndrome against a full
+ *    compute_syndrome_from_bus() on every nibble and counts mismatches.
+ * 0: Release build, cache only.
+ */
+#define ENCODER_DEBUG   0
+
+/* Syndrome Kernel (User-Editable)
+ * SYNDROME_KERNEL_LOOP:   scan the N bits, XOR in the index of every set one
+ *                         (data-dependent branch per bit).
+ * SYNDROME_KERNEL_PARITY: syndrome bit k = parity(x & H1_COL_MASKk), where
+ *                         H1_COL_MASKk selects the columns whose index has
+ *                         bit k set. R masked parities, no branches,
+ *                         constant time. On C51 the byte parity is the PSW P
+ *                         flag of ACC.
+ * The masks are fixed bit patterns cut to N bits by BUS_STATE_MASK, so the
+ * matrix is still not stored (R = 4: 0x5555, 0x6666, 0x7878, 0x7F80).
+ */
+#define SYNDROME_KERNEL_LOOP    0
+#define SYNDROME_KERNEL_PARITY  1
+#define SYNDROME_KERNEL         SYNDROME_KERNEL_PARITY
+
+#define H1_COL_MASK0    ((bus_state_t)(0x55555555UL & BUS_STATE_MASK))
+#define H1_COL_MASK1    ((bus_state_t)(0x66666666UL & BUS_STATE_MASK))
+#define H1_COL_MASK2    ((bus_state_t)(0x78787878UL & BUS_STATE_MASK))
+#define H1_COL_MASK3    ((bus_state_t)(0x7F807F80UL & BUS_STATE_MASK))
+#define H1_COL_MASK4    ((bus_state_t)(0x7FFF8000UL & BUS_STATE_MASK))
+
+/* UART Receive FIFO
+ * Power-of-two ring buffer in IDATA, filled by UART_ISR and drained by main().
+ * Single producer / single consumer: only the ISR writes rx_fifo_head and
+ * only main() writes rx_fifo_tail. 8-bit loads and stores are atomic on the
+ * 8051, so neither side has to disable interrupts to touch the indices.
+ * One slot is always left empty to tell "full" from "empty", so the usable
+ * capacity is RX_FIFO_SIZE - 1 bytes.
+ */
+#define RX_FIFO_SIZE    16                      /* Depth in bytes, power of two */
+#define RX_FIFO_MASK    (RX_FIFO_SIZE - 1)
+
+#if (RX_FIFO_SIZE & RX_FIFO_MASK) != 0
+#error "RX_FIFO_SIZE must be a power of two"
+#endif
+
+/* Number of bytes currently waiting in the FIFO */
+#define RX_FIFO_COUNT() ((uint8_t)(rx_fifo_head - rx_fifo_tail) & RX_FIFO_MASK)
+
+/* Hot-Path Instrumentation (User-Editable)
+ * TX_INSTRUMENT = 1 runs Timer 0 free (16-bit, no interrupt, one core
+ * cycle per count like Timer 1, ~90 ns) and records min/max/sum/count per
+ * stage in tx_stats[] (tx_stats.c):
+ *   STAT_SYNDROME: S_old lookup and S_target in encode_nibble()
+ *   STAT_FIND_W:   find_minimal_w()
+ *   STAT_OUTPUT:   output_to_shift_registers() in process_nibble()
+ *   STAT_HANDOFF:  UART_ISR push to main-loop pop, for bytes that arrive
+ *                  into an empty FIFO (queued bytes would measure backlog)
+ *   STAT_WAKE:     UART_ISR push to the main loop running again after
+ *                  cpu_idle() (TX_IDLE_ENABLE), i.e. the wake latency
+ * The cost of the timestamp itself is measured once at start-up and
+ * subtracted (stat_overhead).
+ * irq_latency_max: worst interrupt latency seen so far. Timer 1 free-runs
+ * in mode 1, so when Timer1_ISR reads it, the count since the overflow is
+ * the time the interrupt waited (plus the fixed vector/entry cost of a few
+ * counts). Any interrupt-disabled window or long ISR shows up here.
+ *
+ * CTRL_STATS, <clear>: the MCU answers
+ *     CTRL_STATS, <len>, <len bytes>
+ * payload (16/32-bit values MSB first):
+ *     stat_overhead(2), rx_overrun_count(1), rx_fifo_peak(1),
+ *     irq_latency_max(2),
+ *     then per stage: count(2), min(2), max(2), sum(4)
+ * A non-zero <clear> resets the stage statistics after the dump.
+ */
+#define TX_INSTRUMENT   0
+#define CTRL_STATS      0x05    /* ASCII ENQ: statistics query */
+
+#define STAT_SYNDROME   0
+#define STAT_FIND_W     1
+#define STAT_OUTPUT     2
+#define STAT_HANDOFF    3
+#define STAT_WAKE       4
+#define STAT_COUNT      5
+
+#define STATS_PAYLOAD_LEN   (6 + STAT_COUNT * 10)
+
+/* Switching-Activity Counters (User-Editable)
+ * TX_TOGGLE_STATS = 1 counts, in encode_nibble():
+ *   toggle_symbols: symbols encoded (including repeats, w = 0)
+ *   toggle_total:   bus line transitions, i.e. weight of every w
+ *   toggle_line[i]: transitions of bus line i + 1 (16-bit, wraps)
+ * In the H1 code w is zero or the single column s_target, so a symbol
+ * costs at most one transition and the line index is s_target itself.
+ * TX_LANES = 2: both lanes are counted together (a byte is two symbols,
+ * toggle_line[i] sums line i + 1 of lane A and of lane B).
+ *
+ * CTRL_TOGGLES, <clear>: the MCU answers
+ *     CTRL_TOGGLES, <len>, <len bytes>
+ * payload (MSB first): toggle_symbols(4), toggle_total(4),
+ *     toggle_line[0..N-1] (2 each)
+ * A non-zero <clear> resets all counters after the dump.
+ */
+#define TX_TOGGLE_STATS 0
+#define CTRL_TOGGLES    0x14    /* ASCII DC4: toggle counter query */
+
+#define TOGGLES_PAYLOAD_LEN (8 + HAMMING_N * 2)
+
+/* Timestamp for interrupt context: TH0/TL0 re-read until the high byte
+ * did not change (no carry between the two reads). Main-loop code uses
+ * stamp_now(), which is not reentrant. */
+#define STAMP_READ(dst) do { \
+    uint8_t stamp_hi_; \
+    do { \
+        stamp_hi_ = TH0; \
+        (dst) = ((uint16_t)stamp_hi_ << 8) | TL0; \
+    } while (stamp_hi_ != TH0); \
+} while (0)
+
+#if TX_INSTRUMENT
+#define STAT_HANDOFF_TAKE()     stat_handoff_take()
+#else
+#define STAT_HANDOFF_TAKE()
+#endif
+
+/* Remove the oldest byte into dst. Main loop context only; the FIFO must
+ * not be empty (check rx_fifo_tail != rx_fifo_head first). */
+#define RX_FIFO_POP(dst) do { \
+    STAT_HANDOFF_TAKE(); \
+    (dst) = rx_fifo[rx_fifo_tail]; \
+    rx_fifo_tail = (rx_fifo_tail + 1) & RX_FIFO_MASK; \
+} while (0)
+
+/* Core Clock (User-Editable)
+ * The ADuC841 runs straight from the crystal (it has no PLLCON; that is
+ * the ADuC842/843). Its 8052 core is single-cycle: one NOP takes one core
+ * cycle, and Timers 0, 1 and 2 count core cycles, ~90.4 ns per count at
+ * 11.0592 MHz. A 16-bit timer wraps every 65536 counts, T1_OVERFLOW_US
+ * (~5.93 ms). The UART table below is exact only at 11.0592 MHz.
+ * T1_TICKS_MS(ms): Timer 1 overflows that cover at least ms milliseconds.
+ * Timer 1 free-runs, so the first overflow ends a random part of a
+ * period; the extra tick makes up for it.
+ */
+#define CORE_CLK_HZ         11059200UL
+#define CORE_CLK_KHZ        (CORE_CLK_HZ / 1000UL)
+#define T1_OVERFLOW_US      (65536000UL / CORE_CLK_KHZ)    /* 5926 us */
+#define T1_TICKS_MS(ms)     (((ms) * 1000UL + T1_OVERFLOW_US - 1) / T1_OVERFLOW_US + 1)
+
+/* UART Baud Rate Table (11.0592 MHz core clock)
+ * Timer 3 generates the baud rate:
+ *     Baud = (2 * fcore) / (2^(DIV - 1) * (T3FD + 64)),  T3CON = 0x80 | DIV
+ * All entries are exact at 11.0592 MHz (table in peripherals.c).
+ */
+#define BAUD_9600       0
+#define BAUD_19200      1
+#define BAUD_38400      2
+#define BAUD_57600      3
+#define BAUD_115200     4
+#define BAUD_230400     5
+#define BAUD_COUNT      6
+
+#define UART_BAUD_DEFAULT   BAUD_9600   /* Rate after reset (User-Editable) */
+
+/* Reserved Byte Values
+ * Outside a burst frame these host bytes are commands, not data (each
+ * only when its option is built in), so a raw byte stream is not 8-bit
+ * transparent:
+ *   0x02 CTRL_BURST    TX_BURST_ENABLE     burst frame header
+ *   0x05 CTRL_STATS    TX_INSTRUMENT       statistics query
+ *   0x0A '\n', 0x0D '\r'  always            batch terminators (no symbols)
+ *   0x12 CTRL_CREDIT   TX_CREDIT_ENABLE    credit request
+ *   0x14 CTRL_TOGGLES  TX_TOGGLE_STATS     toggle counter query
+ *   0x16 CTRL_BAUD     always              baud rate request
+ *   0x18 CTRL_RESYNC   TX_RESYNC_ENABLE    bus resync
+ * Inside a CTRL_BURST frame every byte is data, so a host that sends
+ * arbitrary bytes frames them (host_sender.py does by default).
+ * CTRL_ACK / CTRL_NAK only go from the MCU to the host.
+ */
+
+/* Host Control Bytes and Replies
+ * CTRL_BAUD, <index>: switch to baud table entry <index>. The MCU answers
+ * CTRL_ACK, <index> at the OLD rate, then switches. The host must repeat
+ * CTRL_BAUD, <index> at the NEW rate within BAUD_CONFIRM_MS; the MCU
+ * acknowledges again and keeps the rate. Without that confirmation the MCU
+ * falls back to UART_BAUD_DEFAULT, so a rate the cable cannot carry never
+ * locks the link. An invalid index is answered with CTRL_NAK, <index>.
+ */
+#define CTRL_BAUD       0x16    /* ASCII SYN: baud rate request */
+#define CTRL_ACK        0x06    /* ASCII ACK */
+#define CTRL_NAK        0x15    /* ASCII NAK */
+
+/* Confirmation timeout (User-Editable), counted in Timer 1 overflows.
+ * host_sender.py BAUD_CONFIRM_S must match BAUD_CONFIRM_MS.
+ */
+#define BAUD_CONFIRM_MS     1000
+#define BAUD_CONFIRM_TICKS  T1_TICKS_MS(BAUD_CONFIRM_MS)
+
+#if (BAUD_CONFIRM_MS < 1) || (BAUD_CONFIRM_TICKS > 255)
+#error "BAUD_CONFIRM_MS must be 1..1500"
+#endif
+
+/* Control Sequence Timeout (User-Editable)
+ * tx_handler() reads the argument bytes of a control byte (CTRL_BAUD,
+ * CTRL_BURST, CTRL_STATS, CTRL_TOGGLES) from rx_fifo as they arrive. If no
+ * byte comes for TX_FRAME_TIMEOUT_MS, the sequence is dropped together
+ * with the bytes of it already queued, and tx_handler() returns to the
+ * main loop. A truncated frame, or a stray control byte from line noise,
+ * then costs one timeout instead of hanging the Tx (and the baud fallback,
+ * resync and idle with it) until reset.
+ */
+#define TX_FRAME_TIMEOUT_MS     50
+#define TX_FRAME_TIMEOUT_TICKS  T1_TICKS_MS(TX_FRAME_TIMEOUT_MS)
+
+#if (TX_FRAME_TIMEOUT_MS < 1) || (TX_FRAME_TIMEOUT_TICKS > 255)
+#error "TX_FRAME_TIMEOUT_MS must be 1..1500"
+#endif
 
 /* Shift Register Pin Definitions (User-Editable)
  * Pin mapping for SN74HC595 shift registers.
@@ -23,22 +266,356 @@ sbit SRCLK_PIN = P2^1;   /* Shift register clock (74HC595 pin 11) - rising edge
 sbit RCLK_PIN  = P2^2;   /* Storage register clock / Latch (74HC595 pin 12) - rising edge */
 
 
+/* Redundant-Update Elimination and Symbol Strobe (User-Editable)
+ * TX_SKIP_UNCHANGED: shift_out_state() remembers the latched state and
+ *   skips the whole shift/latch cycle when the new state equals it
+ *   (w = 0, i.e. a repeated symbol such as the 0x6 high nibble of "ab").
+ *   RCLK then does not pulse for that symbol.
+ * TX_SYMBOL_STROBE: STROBE_PIN pulses once per symbol after the outputs
+ *   are valid, repeats included. Wire it to the receiver's INT0 for
+ *   RX_CAPTURE_STROBE; RCLK alone no longer marks every symbol.
+ */
+#define TX_SKIP_UNCHANGED   1
+#define TX_SYMBOL_STROBE    1
+
+sbit STROBE_PIN = P2^3;  /* Symbol strobe to the receiver (INT0, P3.2) */
+
+/* Pipelined Latch (User-Editable)
+ * TX_PIPELINE = 1: shift_out_state() only shifts the next state into the
+ * 74HC595 shift registers while the current one stays on the outputs.
+ * Timer 2 (16-bit auto-reload, interrupt 5) ticks TX_PIPE_RATE_HZ times
+ * a second, every TX_PIPE_TICKS core cycles, and pulses RCLK + STROBE_PIN
+ * if a state is waiting, so symbols appear on a fixed, jitter-free clock.
+ * A tick with nothing loaded carries no symbol (no RCLK, no strobe); a
+ * TX_SKIP_UNCHANGED repeat gets the strobe but no RCLK.
+ * The period must cover one encode plus shift_load(): about 160 us for
+ * the R = 4 bit-bang chain at SRCLK_HZ = 100 kHz, a few us with
+ * SHIFT_DRIVER_SPI. A period shorter than the shift alone
+ * (TX_SHIFT_MIN_CYCLES, below) is an #error.
+ */
+#define TX_PIPELINE         0
+#define TX_PIPE_RATE_HZ     4000UL  /* Symbols/s, 250 us per symbol */
+#define TX_PIPE_TICKS       ((CORE_CLK_HZ + TX_PIPE_RATE_HZ / 2) / TX_PIPE_RATE_HZ)
+#define TX_PIPE_RELOAD      (65536UL - TX_PIPE_TICKS)
+
+#if TX_PIPELINE && ((TX_PIPE_TICKS < 1) || (TX_PIPE_TICKS > 65535))
+#error "TX_PIPE_RATE_HZ out of range: Timer 2 period must be 1..65535 counts"
+#endif
+
 #define DATA_PIN  SER_PIN
 #define CLK_PIN   SRCLK_PIN
 #define LATCH_PIN RCLK_PIN
 
+/* Shift Register Output Driver Selection (User-Editable)
+ * SHIFT_DRIVER_BITBANG: SER/SRCLK toggled in software on SER_PIN/SRCLK_PIN.
+ * SHIFT_DRIVER_SPI:     On-chip SPI master (SPICON/SPIDAT). Wire the ADuC841
+ *                       MOSI pin to SER and SCLOCK to SRCLK; RCLK stays on
+ *                       RCLK_PIN and is pulsed in software after the last byte.
+ */
+#define SHIFT_DRIVER_BITBANG    0
+#define SHIFT_DRIVER_SPI        1
+#define SHIFT_DRIVER            SHIFT_DRIVER_BITBANG
+
+/* SPI bit rate (SPICON SPR1:SPR0), only used with SHIFT_DRIVER_SPI:
+ * 0 = fcore/2, 1 = fcore/4, 2 = fcore/8, 3 = fcore/16
+ * fcore/2 = 5.5 MHz @ 11.0592 MHz, well below the 74HC595 25 MHz limit.
+ */
+#define SPI_RATE_SEL            0
+
+/* Shift Clock Timing (User-Editable, SHIFT_DRIVER_BITBANG only)
+ * One NOP is one core cycle (CORE_CLK_HZ, see Core Clock).
+ * SRCLK_HZ: target bit-bang SRCLK rate. Each SRCLK half-period is padded
+ * with SRCLK_HALF_NOPS = CORE_CLK_HZ / (2 * SRCLK_HZ) NOPs, generated at
+ * compile time (CLK_DELAY_NOPS in shift_output.c). The pin writes and the
+ * loop add a few cycles on top, so the real rate is a little lower.
+ * Lower it for long board traces; 11.0592 MHz allows 21.7 kHz and up.
+ * SRCLK_HZ = 0: no delays at all. Every instruction takes at least one
+ * core cycle (~90 ns at 11.0592 MHz), longer than the 74HC595 minimums
+ * (tw = 20 ns, tsu = 25 ns at 4.5 V), so the loop alone sets the rate.
+ * HC595_TSU_NS: SER setup before SRCLK and SRCLK before RCLK. SETUP_NOPS
+ * is that time in core cycles, rounded up (0 with SRCLK_HZ = 0).
+ */
+#define SRCLK_HZ                100000UL    /* 0 = no delay */
+#define HC595_TSU_NS            25
+
+#if (SRCLK_HZ != 0)
+#define SRCLK_HALF_NOPS         (CORE_CLK_HZ / (2 * SRCLK_HZ))
+#define SETUP_NOPS              ((HC595_TSU_NS * (CORE_CLK_HZ / 1000) + 999999UL) / 1000000UL)
+#else
+#define SRCLK_HALF_NOPS         0
+#define SETUP_NOPS              0
+#endif
+
+#if (SRCLK_HALF_NOPS > 255) || (SETUP_NOPS > 255)
+#error "SRCLK_HZ too low for CORE_CLK_HZ: at most 255 NOPs per half-period"
+#endif
+
+/* Shift Register Topology (User-Editable, SHIFT_DRIVER_BITBANG only)
+ * SHIFT_TOPOLOGY_CHAIN: the chips are daisy-chained (QH' -> SER of the next
+ *   chip) and share SRCLK/RCLK. Every update shifts all N bits.
+ * SHIFT_TOPOLOGY_SPLIT: the chips are NOT chained. SER_PIN and RCLK_PIN go
+ *   to every chip, but chip k has its own SRCLK on P2.(SPLIT_SRCLK_BIT0 + k):
+ *       chip 0: bus lines  1..8   (bits 0..7)    SRCLK on P2.4
+ *       chip 1: bus lines  9..16  (bits 8..15)   SRCLK on P2.5
+ *       chip 2: bus lines 17..24  (bits 16..23)  SRCLK on P2.6
+ *       chip 3: bus lines 25..31  (bits 24..30)  SRCLK on P2.7
+ *   Only chips whose byte changed are clocked; their shift registers keep
+ *   the last value shifted in, so the shared RCLK re-latches the others
+ *   unchanged. A weight-1 w touches one chip: 8 clocks instead of N
+ *   (R = 4: 8 vs 15, R = 5: 8 vs 31). SRCLK_PIN is unused.
+ */
+#define SHIFT_TOPOLOGY_CHAIN    0
+#define SHIFT_TOPOLOGY_SPLIT    1
+#define SHIFT_TOPOLOGY          SHIFT_TOPOLOGY_CHAIN
+
+#define SPLIT_SRCLK_BIT0        4       /* P2 bit of chip 0's SRCLK */
+#define SPLIT_SRCLK_MASK(k)     ((uint8_t)(1 << (SPLIT_SRCLK_BIT0 + (k))))
+#define SPLIT_SRCLK_ALL         ((uint8_t)(((1 << SHIFT_CHAIN_CHIPS) - 1) << SPLIT_SRCLK_BIT0))
+
+#if (SHIFT_TOPOLOGY == SHIFT_TOPOLOGY_SPLIT) && (SHIFT_DRIVER != SHIFT_DRIVER_BITBANG)
+#error "SHIFT_TOPOLOGY_SPLIT needs SHIFT_DRIVER_BITBANG (one SCLOCK pin on the SPI master)"
+#endif
+
+#if (SHIFT_TOPOLOGY == SHIFT_TOPOLOGY_SPLIT) && (SPLIT_SRCLK_BIT0 + SHIFT_CHAIN_CHIPS > 8)
+#error "Split SRCLK pins do not fit in P2"
+#endif
+
+/* Two-Lane Bus (User-Editable)
+ * TX_LANES = 2 drives a second, independent 15-line H1 bus (lane B) from
+ * its own 74HC595 chain. Lane B's SER is SER_B_PIN; SRCLK and RCLK are
+ * shared, so both lanes shift in parallel and latch on the same edge.
+ * Every data byte is then ONE symbol period instead of two:
+ *   lane A: high nibble (current_bus_state,   current_syndrome)
+ *   lane B: low nibble  (current_bus_state_b, current_syndrome_b)
+ * Each lane is encoded on its own, so each still toggles at most one
+ * line per symbol. A latched word (tx_word_t) holds lane A in bits 0..14
+ * and lane B in bits 16..30.
+ * Needs HAMMING_R = 4 (one byte per symbol) and the bit-bang chain (the
+ * SPI master and the split topology have a single data path). The Rx
+ * must be built with RX_LANES = 2.
+ */
+#define TX_LANES                1
+
+sbit SER_B_PIN = P2^4;   /* Lane B serial data input (second chain, pin 14) */
+
+#if (TX_LANES != 1) && (TX_LANES != 2)
+#error "TX_LANES must be 1 or 2"
+#endif
+
+#if (TX_LANES == 2) && (HAMMING_R != 4)
+#error "TX_LANES = 2 needs HAMMING_R = 4"
+#endif
+
+#if (TX_LANES == 2) && ((SHIFT_DRIVER != SHIFT_DRIVER_BITBANG) || (SHIFT_TOPOLOGY != SHIFT_TOPOLOGY_CHAIN))
+#error "TX_LANES = 2 needs SHIFT_DRIVER_BITBANG with SHIFT_TOPOLOGY_CHAIN"
+#endif
+
+#if (TX_LANES == 2)
+typedef unsigned long tx_word_t;
+#define TX_WORD_MASK        (BUS_STATE_MASK | ((unsigned long)BUS_STATE_MASK << 16))
+#define TX_WORD(a, b)       ((tx_word_t)(a) | ((tx_word_t)(b) << 16))
+#else
+typedef bus_state_t tx_word_t;
+#define TX_WORD_MASK        TX_SHIFT_MASK
+#define TX_WORD(a, b)       ((tx_word_t)(a))
+#endif
+
+/* Aux Parity Line (User-Editable)
+ * TX_AUX_PARITY = 1 drives one more shift register output, bit HAMMING_N
+ * of the latched word (R = 4: QH of the second 74HC595, left free by the
+ * 15 lines), with the parity of the N bus lines. Lines plus aux line then
+ * always hold an even number of ones. A data symbol toggles at most one
+ * line and the aux line toggles with it, so it also marks every change
+ * of the bus.
+ * A glitch on any single line makes the parity odd, which the Rx
+ * (RX_AUX_PARITY) checks on every sample. The encoder and the syndrome
+ * are not affected: shift_out_state() adds the bit, so every latch (data
+ * and resync) carries it. Needs TX_LANES = 1.
+ */
+#define TX_AUX_PARITY           0
+
+#if TX_AUX_PARITY && (TX_LANES != 1)
+#error "TX_AUX_PARITY needs TX_LANES = 1"
+#endif
+
+#if TX_AUX_PARITY
+#define TX_AUX_BIT          ((bus_state_t)(1UL << HAMMING_N))
+#else
+#define TX_AUX_BIT          0
+#endif
+#define TX_SHIFT_MASK       (BUS_STATE_MASK | TX_AUX_BIT)   /* Outputs of one chain */
+#define TX_SHIFT_BITS       (HAMMING_N + TX_AUX_PARITY)
+#define TX_SHIFT_MSB        ((bus_state_t)(1UL << (TX_SHIFT_BITS - 1)))
+
+/* Lower bound of one shift_load() in core cycles: the SRCLK delays plus
+ * TX_SHIFT_BIT_CYCLES of pin writes and loop per bit (bit-bang, every chip
+ * clocked), or the SPI bit clock. The encode and the call come on top.
+ */
+#define TX_SHIFT_BIT_CYCLES     8
+#if (SHIFT_DRIVER == SHIFT_DRIVER_SPI)
+#define TX_SHIFT_MIN_CYCLES     (SHIFT_CHAIN_CHIPS * 8UL * (2UL << SPI_RATE_SEL))
+#elif (SHIFT_TOPOLOGY == SHIFT_TOPOLOGY_SPLIT)
+#define TX_SHIFT_MIN_CYCLES     (SHIFT_CHAIN_CHIPS * 8UL * (2UL * SRCLK_HALF_NOPS + TX_SHIFT_BIT_CYCLES))
+#else
+#define TX_SHIFT_MIN_CYCLES     (TX_SHIFT_BITS * (2UL * SRCLK_HALF_NOPS + TX_SHIFT_BIT_CYCLES))
+#endif
+
+#if TX_PIPELINE && (TX_PIPE_TICKS < TX_SHIFT_MIN_CYCLES)
+#error "TX_PIPE_RATE_HZ too high: one symbol period is shorter than shift_load()"
+#endif
+
+/* Low-Power Idle (User-Editable)
+ * TX_IDLE_ENABLE = 1: when rx_fifo is empty and no flag is pending, the
+ * main loop calls cpu_idle(), which sets PCON.IDL. The CPU clock stops;
+ * the UART, the timers and the interrupt system keep running, and the next
+ * interrupt (UART byte, Timer 1 tick every ~5.93 ms, Timer 2 with
+ * TX_PIPELINE) ends the idle after its ISR. The measured wake latency is
+ * STAT_WAKE (TX_INSTRUMENT).
+ */
+#define TX_IDLE_ENABLE          1
+
+/* Burst Mode (User-Editable)
+ * The host can frame a block of data as
+ *     CTRL_BURST, <len>, <len payload bytes>
+ * tx_handler() then waits until the payload is in rx_fifo, encodes all of
+ * its symbols into a state buffer first, and latches the states
+ * back-to-back without returning to the main loop in between. The symbol
+ * period inside a burst is one shift/latch cycle plus TX_BURST_GAP_LOOPS,
+ * so the receiver sees a fixed cadence for the whole frame.
+ * With TX_PIPELINE the cadence is the Timer 2 symbol clock instead.
+ * Inside a frame every byte is data ('\r'/'\n' are not terminators).
+ * Frames longer than TX_BURST_MAX_BYTES are sent as several bursts.
+ */
+#define TX_BURST_ENABLE         1
+#define CTRL_BURST              0x02    /* ASCII STX: burst frame header */
+#define TX_BURST_MAX_BYTES      6       /* Payload bytes encoded per burst */
+#define TX_BURST_GAP_LOOPS      0       /* Delay between latches, 0 = back-to-back */
+
+/* State buffer size: worst case includes up to R-1 carried bits
+ * (TX_LANES = 2: one latched word per byte) */
+#if (TX_LANES == 2)
+#define TX_BURST_MAX_SYMBOLS    TX_BURST_MAX_BYTES
+#else
+#define TX_BURST_MAX_SYMBOLS    ((TX_BURST_MAX_BYTES * 8 + HAMMING_R - 1) / HAMMING_R)
+#endif
+
+#if TX_BURST_ENABLE && (TX_BURST_MAX_BYTES > RX_FIFO_SIZE - 1)
+#error "TX_BURST_MAX_BYTES must fit in the RX FIFO"
+#endif
+
+/* Credit Flow Control (User-Editable)
+ * CTRL_CREDIT: the MCU answers CTRL_CREDIT, <free> with the number of free
+ * rx_fifo bytes and from then on returns consumed bytes as
+ * CTRL_CREDIT, <n>: after every TX_CREDIT_BATCH bytes taken from the FIFO,
+ * and for any remainder as soon as the FIFO runs empty. A host that never
+ * has more bytes in flight than it holds credits for cannot overrun the
+ * FIFO at any baud rate, and needs no fixed delays.
+ * Every byte the host sends uses one credit, control bytes included.
+ */
+#define TX_CREDIT_ENABLE        1
+#define CTRL_CREDIT             0x12    /* ASCII DC2: credit request / report */
+#define TX_CREDIT_BATCH         4       /* Consumed bytes per credit report */
+
+#if TX_CREDIT_ENABLE && (TX_CREDIT_BATCH > RX_FIFO_SIZE - 1)
+#error "TX_CREDIT_BATCH must be smaller than RX_FIFO_SIZE"
+#endif
+
+/* Bus Resync (User-Editable)
+ * The receiver decodes every sample on its own (S is the syndrome of the
+ * whole bus), but a missed or extra sample shifts its symbol packing, and
+ * every later character is then built from the wrong symbols. A resync
+ * returns the bus to the all-zero state and marks the point where both
+ * sides restart the packing:
+ *   1. R = 3, 5: carried bits are sent first, zero-padded to one symbol,
+ *      so no data bit is lost (the receiver drops the padding)
+ *   2. If fewer than two lines are high, latch state ^ TX_RESYNC_PREP
+ *      (lines 1-3: columns 1 ^ 2 ^ 3 = 0, so the syndrome is unchanged)
+ *   3. Latch the all-zero state: each high line toggles once, the fewest
+ *      toggles that reach it; current_syndrome = 0
+ * A symbol changes at most one line, so both latches are multi-line
+ * changes no symbol can make. The Rx (RX_RESYNC_ENABLE) skips a
+ * multi-line change that keeps the syndrome and restarts on one that ends
+ * at all-zero. TX_LANES = 2: the marker is on lane A; lane B goes to zero
+ * in step 3.
+ *
+ * Triggers: CTRL_RESYNC from the host, and every TX_RESYNC_INTERVAL data
+ * bytes (0 = host only), checked between characters and between bursts so
+ * a character is never split. Resync latches are not counted by
+ * TX_TOGGLE_STATS.
+ */
+#define TX_RESYNC_ENABLE        1
+#define CTRL_RESYNC             0x18    /* ASCII CAN: resync request */
+#define TX_RESYNC_INTERVAL      0       /* Data bytes between resyncs, 0 = off */
+#define TX_RESYNC_PREP          ((bus_state_t)0x07)
+
+#if TX_RESYNC_ENABLE && (TX_RESYNC_INTERVAL > 65535)
+#error "TX_RESYNC_INTERVAL must be 0..65535"
+#endif
+
 /*Global Variables (Externs) */
 
-/* Stateful bus state: 15-bit vector, only bits 0..14 are used.
+/* Stateful bus state: N-bit vector, only bits 0..N-1 are used.
  * current_bus_state is the "x" vector where H * x^T = S_current.
  * INITIALIZED TO ZERO in main.c. */
-extern volatile uint16_t current_bus_state;
+extern volatile bus_state_t current_bus_state;
+
+/* Cached syndrome of current_bus_state: always equals H * current_bus_state^T.
+ * Since every update is current_bus_state ^= w with H * w^T = S_new ^ S_old,
+ * the new syndrome is simply the S_new that was just applied.
+ * INITIALIZED TO ZERO in main.c (syndrome of the all-zero bus). */
+extern volatile uint8_t current_syndrome;
+
+#if ENCODER_DEBUG
+/* Number of times the cache disagreed with the full recomputation */
+extern volatile uint8_t syndrome_mismatch_count;
+#endif
+
+#if (TX_LANES == 2)
+/* Lane B bus state and its cached syndrome (same rules as lane A) */
+extern volatile bus_state_t current_bus_state_b;
+extern volatile uint8_t current_syndrome_b;
+#endif
+
+/* UART transmit / baud rate state (peripherals.c) */
+extern volatile bit uart_tx_busy;         /* SBUF holds a byte still being sent */
+extern volatile bit baud_revert_flag;     /* Timer 1 ISR: confirmation timed out */
+extern volatile uint8_t baud_index;       /* Current baud table entry */
+extern volatile uint8_t timer1_ticks;     /* Timer 1 overflows, wraps at 256 */
 
 /* Legacy flags (preserved from original codebase) */
 extern volatile bit buffer_flag;        /* Flag: Ready to process batch */
-extern volatile bit tx_flag;            /* Flag: New byte received from ISR */
 extern volatile uint8_t buffer_count;   /* Current nibble count in buffer */
-extern volatile uint8_t tx_temp_byte;   /* Raw byte from UART ISR */
+
+/* UART receive FIFO (see RX_FIFO_SIZE above) */
+extern volatile uint8_t idata rx_fifo[RX_FIFO_SIZE];
+extern volatile uint8_t rx_fifo_head;       /* Next slot to write (UART_ISR only) */
+extern volatile uint8_t rx_fifo_tail;       /* Next slot to read (main loop only) */
+extern volatile uint8_t rx_overrun_count;   /* Bytes dropped on a full FIFO (saturates at 255) */
+extern volatile uint8_t rx_fifo_peak;       /* High-water mark of the FIFO fill level */
+
+#if TX_TOGGLE_STATS
+/* Switching activity (see Switching-Activity Counters), defined in main.c */
+extern unsigned long toggle_symbols;
+extern unsigned long toggle_total;
+extern uint16_t idata toggle_line[HAMMING_N];
+#endif
+
+#if TX_INSTRUMENT
+/* Per-stage timing in Timer 0 counts (see Hot-Path Instrumentation) */
+typedef struct
+{
+    uint16_t count;             /* Samples, saturates at 0xFFFF */
+    uint16_t min;
+    uint16_t max;
+    unsigned long sum;          /* avg = sum / count */
+} stage_stat_t;
+
+extern stage_stat_t idata tx_stats[STAT_COUNT];
+extern uint16_t stat_overhead;          /* Cost of one timestamp pair */
+extern volatile uint16_t irq_latency_max;  /* Timer1_ISR: worst entry delay */
+extern volatile uint16_t rx_stamp;      /* UART_ISR: arrival of a byte into an empty FIFO */
+extern volatile bit rx_stamp_valid;
+#endif
 
 /*Function Prototypes  */
 
@@ -48,58 +625,137 @@ void UART_Init(void);
 void GlobalINT(void);
 void Port_Init(void);
 
+/* UART Baud Rate and Transmit */
+void UART_SetBaud(uint8_t index);
+void uart_putc(uint8_t value);
+void uart_flush(void);
+void baud_request(uint8_t index);
+void baud_timeout_check(void);
+void Timer1_Init(void);
+#if TX_IDLE_ENABLE
+void cpu_idle(void);
+#endif
+
 /* H1-Type Bus Encoder Core Functions */
 
-/*process_nibble - Process a single 4-bit syndrome (S_new) and update bus state
- * s_new: The new 4-bit syndrome value (0x0 to 0xF)
+/*process_nibble - Process a single R-bit syndrome (S_new) and update bus state
+ * s_new: The new syndrome value (0 to 2^R - 1; a nibble for the default R = 4)
  * 
  * This function:
- * 1. Computes S_old from current_bus_state via H * current_bus_state^T
+ * 1. Takes S_old from the cached current_syndrome (O(1), no bus scan)
  * 2. Computes S_target = S_new ^ S_old
  * 3. Finds minimal-weight w such that H * w^T == S_target
  * 4. Updates current_bus_state ^= w
- * 5. Outputs the new state to shift registers
+ * 5. Stores S_new as the new current_syndrome
+ * 6. Outputs the new state to shift registers
  */
 void process_nibble(uint8_t s_new);
 
+/*encode_nibble - Steps 1-5 of process_nibble() without the shift register output
+ * s_new: The new syndrome value (0 to 2^R - 1)
+ * 
+ * Updates current_bus_state and current_syndrome only. Used by burst mode to
+ * precompute a series of bus states before latching them.
+ */
+void encode_nibble(uint8_t s_new);
+
+#if (TX_LANES == 2)
+/*encode_nibble_b - encode_nibble() for lane B
+ * s_new: The new lane B syndrome value (0 to 15)
+ * 
+ * Updates current_bus_state_b and current_syndrome_b only.
+ */
+void encode_nibble_b(uint8_t s_new);
+#endif
+
 /**
  * compute_syndrome_from_bus - Compute H * x^T on-the-fly
- * bus_state: The 15-bit bus state x (bits 0..14)
- * return: The 4-bit syndrome S = H * x^T
+ * bus_state: The N-bit bus state x (bits 0..N-1)
+ * return: The R-bit syndrome S = H * x^T
  * 
- * Column i (1..15) of the H1 matrix is just the binary representation of i.
- * This function computes the syndrome using bitwise XOR of column indices
- * for all bits that are set in bus_state.
+ * Column i (1..N) of the H1 matrix is just the binary representation of i.
+ * SYNDROME_KERNEL_PARITY: bit k = parity(bus_state & H1_COL_MASKk).
+ * SYNDROME_KERNEL_LOOP: XOR of the column indices of all set bits.
  */
-uint8_t compute_syndrome_from_bus(uint16_t bus_state);
+uint8_t compute_syndrome_from_bus(bus_state_t bus_state);
+
+#if TX_AUX_PARITY
+/*bus_parity - Parity of the N bus lines (1 = odd), the TX_AUX_PARITY bit */
+uint8_t bus_parity(bus_state_t bus_state);
+#endif
 
 /*find_minimal_w - Find minimal Hamming-weight vector w such that H*w^T = s_target
- * s_target: The target 4-bit syndrome (0x0 to 0xF)
- * return: The 15-bit w vector with minimal Hamming weight
+ * s_target: The target R-bit syndrome (0 to 2^R - 1)
+ * return: The N-bit w vector with minimal Hamming weight
  * 
  * Algorithm: Bounded search exploiting H1-type structure.
  * For any nonzero s_target, weight-1 solution exists (w = single bit at position s_target-1).
  * If s_target is zero, w = 0 (weight-0).
  * Tie-breaker: smallest numeric value of w.
  */
-uint16_t find_minimal_w(uint8_t s_target);
+bus_state_t find_minimal_w(uint8_t s_target);
 
-/*output_to_shift_registers - Bit-bang current_bus_state to chained 74HC595 shift registers
+/*output_to_shift_registers - Send current_bus_state to chained 74HC595 shift registers
  * 
- * Shift order: MSB-first (bit 14 down to bit 0).
+ * TX_LANES = 2: both lanes, TX_WORD(current_bus_state, current_bus_state_b).
+ * Shift order: MSB-first (bit N-1 down to bit 0).
  * Protocol: For each bit, set SER then pulse SRCLK; finally pulse RCLK to latch.
- * CLK timing targets ~100 kHz with NOP-based delays.
+ * SHIFT_DRIVER_BITBANG: CLK timing targets ~100 kHz with NOP-based delays.
+ * SHIFT_DRIVER_SPI:     SHIFT_CHAIN_CHIPS SPIDAT bytes (high byte first), then RCLK pulse.
+ * SHIFT_TOPOLOGY_SPLIT: only the chips whose byte changed are shifted, then RCLK pulse.
  */
 void output_to_shift_registers(void);
 
+/*shift_out_state - Send an arbitrary bus state to the 74HC595 chain and latch it
+ * state: The N-bit bus state to display (TX_LANES = 2: a TX_WORD of both lanes)
+ * 
+ * output_to_shift_registers() is shift_out_state(current_bus_state).
+ * TX_AUX_PARITY: the aux bit is added here, callers pass the N lines only.
+ */
+void shift_out_state(tx_word_t state);
+
+#if TX_PIPELINE
+/*Timer2_Init - Start the symbol clock for the pipelined latch (shift_output.c) */
+void Timer2_Init(void);
+#endif
+
+#if TX_INSTRUMENT
+/* Instrumentation (tx_stats.c) */
+void stats_init(void);                  /* Start Timer 0, clear, calibrate */
+uint16_t stamp_now(void);               /* Timer 0 count, main loop only */
+void stat_record(uint8_t stage, uint16_t start);
+void stat_handoff_take(void);           /* Used by RX_FIFO_POP */
+void stats_dump(uint8_t clear);         /* CTRL_STATS reply */
+#endif
+
+#if TX_TOGGLE_STATS
+void toggles_dump(uint8_t clear);       /* CTRL_TOGGLES reply (tx_stats.c) */
+#endif
+
 /*tx_handler - Handle received UART character
  * rx_char: The received character
  * 
  * For non-terminator characters:
- * Splits character into high nibble and low nibble
- * Processes high nibble first, then low nibble
+ * Splits character into R-bit symbols, most significant bits first
+ * (R = 4: high nibble first, then low nibble;
+ * TX_LANES = 2: high nibble on lane A, low nibble on lane B, one latch)
  * For '\r' or '\n': sets buffer_flag (preserved for compatibility)
+ * For CTRL_BURST: reads <len> and the payload from rx_fifo and sends it as
+ * one burst (see Burst Mode above)
+ * For CTRL_BAUD: reads <index> from rx_fifo and runs the baud handshake
+ * For CTRL_CREDIT: replies with the free FIFO space (see Credit Flow Control)
+ * For CTRL_STATS (TX_INSTRUMENT): reads <clear> and dumps the statistics
+ * For CTRL_TOGGLES (TX_TOGGLE_STATS): reads <clear> and dumps the counters
+ * For CTRL_RESYNC (TX_RESYNC_ENABLE): returns the bus to the zero state
+ * (see Bus Resync above)
  */
 void tx_handler(uint8_t rx_char);
 
+/*credit_report - Return FIFO credits to the host (TX_CREDIT_ENABLE)
+ * Call from the main loop after tx_handler(). Sends CTRL_CREDIT, <n> once
+ * TX_CREDIT_BATCH bytes were consumed, or when the FIFO is empty.
+ * Does nothing until the host has sent CTRL_CREDIT.
+ */
+void credit_report(void);
+
 #endif
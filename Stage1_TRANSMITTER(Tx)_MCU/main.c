@@ -8,60 +8,115 @@
 
 /* GLOBAL VARIABLE DEFINITIONS */
 
-/* current_bus_state: The 15-bit physical bus state vector x.
- * Only bits 0..14 are used (BUS_STATE_MASK = 0x7FFF).
+/* current_bus_state: The N-bit physical bus state vector x.
+ * Only bits 0..N-1 are used (BUS_STATE_MASK, 0x7FFF for R = 4).
  * H * current_bus_state^T = S_current (the current syndrome)
  */
-volatile uint16_t current_bus_state = 0;
+volatile bus_state_t current_bus_state = 0;
+
+/* current_syndrome: H * current_bus_state^T, maintained by process_nibble().
+ * Zero bus => zero syndrome.
+ */
+volatile uint8_t current_syndrome = 0;
+
+#if ENCODER_DEBUG
+volatile uint8_t syndrome_mismatch_count = 0;
+#endif
+
+#if (TX_LANES == 2)
+/* Lane B: second H1 bus, starts at the zero state like lane A */
+volatile bus_state_t current_bus_state_b = 0;
+volatile uint8_t current_syndrome_b = 0;
+#endif
 
 /* Legacy status flags (preserved for compatibility) */
 volatile bit buffer_flag = 0;   /* Set when batch terminator received */
-volatile bit tx_flag = 0;       /* Set by UART ISR when byte received */
 
 /* Buffer tracking */
 volatile uint8_t buffer_count = 0;  /* Nibble count processed */
 
-/* UART receive buffer */
-volatile uint8_t tx_temp_byte = 0;  /* Raw byte from UART ISR */
+#if TX_TOGGLE_STATS
+/* Switching activity, updated by encode_nibble() */
+unsigned long toggle_symbols = 0;       /* Symbols encoded */
+unsigned long toggle_total = 0;         /* Bus line transitions */
+uint16_t idata toggle_line[HAMMING_N];  /* Transitions per line (cleared in main()) */
+#endif
+
+/* UART receive FIFO: written by UART_ISR, drained by the main loop */
+volatile uint8_t idata rx_fifo[RX_FIFO_SIZE];
+volatile uint8_t rx_fifo_head = 0;
+volatile uint8_t rx_fifo_tail = 0;
+
+/* FIFO statistics */
+volatile uint8_t rx_overrun_count = 0;  /* Bytes lost because the FIFO was full */
+volatile uint8_t rx_fifo_peak = 0;      /* Deepest fill level seen so far */
 
 /* MAIN FUNCTION */
 void main(void)
 {
+    uint8_t rx_char;
+#if TX_TOGGLE_STATS
+    uint8_t line;
+#endif
+    
     /* --- Hardware Initialization --- */
     GlobalINT();        /* Enable global interrupts */
-    Timer3_Init();      /* Configure Timer 3 for 9600 baud */
-    UART_Init();        /* Configure UART: 8N1, 9600 baud */
+    Timer3_Init();      /* Configure Timer 3 for UART_BAUD_DEFAULT */
+    UART_Init();        /* Configure UART: 8N1 */
+    Timer1_Init();      /* Baud confirmation timeout */
     Port_Init();        /* Initialize shift register GPIO pins */
+#if TX_PIPELINE
+    Timer2_Init();      /* Symbol clock, must run before the first output */
+#endif
+#if TX_TOGGLE_STATS
+    for (line = 0; line < HAMMING_N; line++)
+    {
+        toggle_line[line] = 0;      /* Do not rely on the startup RAM clear */
+    }
+#endif
+#if TX_INSTRUMENT
+    stats_init();       /* Timer 0 timestamps for the stage statistics */
+#endif
     
     /* --- Initial bus state output --- */
     /* Output the initial zero state to shift registers */
     output_to_shift_registers();
     
-     /* The main loop handles two events:
-     * 1. tx_flag set by UART ISR: Process received character
-     * 2. buffer_flag set by terminator: Perform any batch-end actions
+     /* The main loop handles three events:
+     * 1. Bytes queued in rx_fifo by UART ISR: Process each received character
+     * 2. baud_revert_flag set by Timer 1 ISR: Return to the default baud rate
+     * 3. buffer_flag set by terminator: Perform any batch-end actions
+     * and then idles until the next interrupt (TX_IDLE_ENABLE).
      */
     while (1)
     {
-        /* --- Handle UART Reception --- */
-        if (tx_flag == 1)
+        /* --- Drain UART Receive FIFO --- */
+        while (rx_fifo_tail != rx_fifo_head)
         {
-            tx_flag = 0;
+            /* Pop first so the ISR gets the slot back while we encode */
+            RX_FIFO_POP(rx_char);
             
             /* 
              * tx_handler() splits the character into high/low nibbles,
              * processes each through the H1 encoder, and outputs to
              * shift registers after each nibble.
              */
-            tx_handler(tx_temp_byte);
+            tx_handler(rx_char);
+            
+#if TX_CREDIT_ENABLE
+            /* Hand the freed FIFO space back to a streaming host */
+            credit_report();
+#endif
         }
         
+        /* --- Drop an unconfirmed baud rate --- */
+        baud_timeout_check();
+        
         /* --- Handle Batch Terminator --- */
         if (buffer_flag)
         {
-            /* Enter critical section */
-            ES = 0;  /* Disable UART interrupt */
-            
+            /* buffer_flag and buffer_count are only written by tx_handler()
+             * in this loop, so no critical section is needed */
             buffer_flag = 0;
             
             /*Batch terminator received ('\r' or '\n').
@@ -72,9 +127,11 @@ void main(void)
              * For now, we just reset the counter for statistics.
              */
             buffer_count = 0;
-            
-            /* Exit critical section */
-            ES = 1;  /* Re-enable UART interrupt */
         }
+        
+#if TX_IDLE_ENABLE
+        /* --- Nothing to do: sleep until the next interrupt --- */
+        cpu_idle();
+#endif
     }
 }
@@ -6,18 +6,49 @@
 #include <aduc841.h>
 #include "header.h"
 
+/* UART baud rate and transmit state */
+volatile bit uart_tx_busy = 0;
+volatile bit baud_revert_flag = 0;
+volatile uint8_t baud_index = UART_BAUD_DEFAULT;
+volatile uint8_t timer1_ticks = 0;
+
+/* Remaining Timer 1 overflows before an unconfirmed rate is dropped */
+static volatile uint8_t baud_confirm_ticks = 0;
+
+/* Timer 3 settings per baud table entry (BAUD_9600 .. BAUD_230400)
+ * DIV = floor(log2(fcore / (16 * Baud))), T3FD = 2 * fcore / (2^(DIV-1) * Baud) - 64
+ */
+static uint8_t code baud_t3con[BAUD_COUNT] = { 0x86, 0x85, 0x84, 0x83, 0x82, 0x81 };
+static uint8_t code baud_t3fd[BAUD_COUNT]  = { 0x08, 0x08, 0x08, 0x20, 0x20, 0x20 };
+
 /*Timer3_Init
- * Configure Timer 3 as UART baud rate generator for 9600 baud.
+ * Configure Timer 3 as UART baud rate generator for UART_BAUD_DEFAULT.
  * 
- * ADuC841 Timer 3 configuration for 9600 baud with 11.0592 MHz crystal:
+ * ADuC841 Timer 3 configuration with 11.0592 MHz crystal:
  * T3CON settings and T3FD fractional divider per datasheet.
  */
  
 void Timer3_Init(void)
 {
-    T3CON &= 0xFE;  /* Disable Timer 3 */
-    T3CON |= 0x86;  /* Set mode bits for UART baud generation */
-    T3FD = 0x08;    /* Fractional divider for 9600 baud accuracy */
+    UART_SetBaud(UART_BAUD_DEFAULT);
+}
+
+/* UART_SetBaud
+ * Reprogram Timer 3 for baud table entry index (BAUD_xxx).
+ * Any byte still in SBUF must be flushed first (uart_flush).
+ */
+
+void UART_SetBaud(uint8_t index)
+{
+    if (index >= BAUD_COUNT)
+    {
+        return;
+    }
+    
+    T3CON = 0x00;                   /* Stop baud generation */
+    T3FD  = baud_t3fd[index];       /* Fractional divider */
+    T3CON = baud_t3con[index];      /* T3BAUDEN + DIV */
+    baud_index = index;
 }
 
 /* UART_Init
@@ -36,6 +67,104 @@ void UART_Init(void)
     ES = 1;     /* Enable serial interrupt */
 }
 
+/* Timer1_Init
+ * Timer 1 as free-running 16-bit timer (mode 1), used for the baud rate
+ * confirmation and control sequence timeouts. One overflow every 65536
+ * core cycles (T1_OVERFLOW_US, ~5.93 ms).
+ */
+
+void Timer1_Init(void)
+{
+    TMOD &= 0x0F;
+    TMOD |= 0x10;   /* Mode 1: 16-bit timer */
+    TH1 = 0;
+    TL1 = 0;
+    ET1 = 1;        /* Enable Timer 1 interrupt */
+    TR1 = 1;        /* Start timer */
+}
+
+/* uart_putc
+ * Send one byte. Waits while the previous byte is still in SBUF;
+ * UART_ISR clears uart_tx_busy on TI.
+ */
+
+void uart_putc(uint8_t value)
+{
+    while (uart_tx_busy);
+    uart_tx_busy = 1;
+    SBUF = value;
+}
+
+/* uart_flush
+ * Wait until the last byte has left SBUF.
+ */
+
+void uart_flush(void)
+{
+    while (uart_tx_busy);
+}
+
+/* baud_request
+ * Handle CTRL_BAUD, <index> from the host (see header.h for the handshake).
+ *
+ * 1. Invalid index: reply CTRL_NAK, index
+ * 2. Reply CTRL_ACK, index at the current rate
+ * 3. Same index as the current rate: this is the host's confirmation
+ *    at the new rate, so stop the fallback timeout
+ * 4. Otherwise flush the reply, switch Timer 3 and start the timeout
+ */
+
+void baud_request(uint8_t index)
+{
+    volatile uint8_t i, j;
+    
+    /* Step 1: Reject unknown table entries */
+    if (index >= BAUD_COUNT)
+    {
+        uart_putc(CTRL_NAK);
+        uart_putc(index);
+        return;
+    }
+    
+    /* Step 2: Acknowledge at the rate the host is using right now */
+    uart_putc(CTRL_ACK);
+    uart_putc(index);
+    
+    /* Step 3: Confirmation - keep this rate */
+    if (index == baud_index)
+    {
+        baud_confirm_ticks = 0;     /* ISR can no longer raise the flag... */
+        baud_revert_flag = 0;       /* ...so a pending one is dropped safely */
+        return;
+    }
+    
+    /* Step 4: TI is raised at the start of the stop bit, so wait a little
+     * longer (>= one bit at 9600 baud) before changing the rate */
+    uart_flush();
+    for (j = 0; j < 4; j++)
+    {
+        for (i = 0; i < 255; i++);
+    }
+    
+    UART_SetBaud(index);
+    baud_confirm_ticks = (index == UART_BAUD_DEFAULT) ? 0 : BAUD_CONFIRM_TICKS;
+}
+
+/* baud_timeout_check
+ * Main loop: fall back to UART_BAUD_DEFAULT when the host never confirmed
+ * the new rate.
+ */
+
+void baud_timeout_check(void)
+{
+    if (baud_revert_flag)
+    {
+        baud_revert_flag = 0;
+        uart_flush();
+        UART_SetBaud(UART_BAUD_DEFAULT);
+    }
+}
+
 /* GlobalINT
  * Enable global interrupt
  */
@@ -45,28 +174,132 @@ void GlobalINT(void)
     EA = 1;     /* Enable All interrupts */
 }
 
+#if TX_IDLE_ENABLE
+/* cpu_idle
+ * Main loop: enter IDLE mode if there is no work, return after the next
+ * interrupt has been served.
+ *
+ * A byte that arrives between the empty test and setting IDL would sit in
+ * the FIFO until some later interrupt. EA = 0 closes that gap: the 8051
+ * executes one more instruction after any write to IE before it takes an
+ * interrupt, so "SETB EA; ORL PCON,#01H" enters IDLE with such an
+ * interrupt already pending, and it ends the idle at once.
+ */
+
+void cpu_idle(void)
+{
+    EA = 0;
+    
+    if (rx_fifo_tail == rx_fifo_head && !baud_revert_flag && !buffer_flag)
+    {
+        EA = 1;
+        PCON |= 0x01;   /* IDL: CPU stops until an interrupt */
+        
+#if TX_INSTRUMENT
+        /* Woken by a byte: rx_stamp is its arrival in UART_ISR */
+        if (rx_stamp_valid)
+        {
+            stat_record(STAT_WAKE, rx_stamp);
+        }
+#endif
+    }
+    
+    EA = 1;
+}
+#endif
+
 /* UART_ISR
  * UART Interrupt Service Routine (Interrupt 4).
  * 
  * On receive (RI):
  * Clear RI flag
- * Copy SBUF to tx_temp_byte
- * Set tx_flag to signal main loop
+ * Push SBUF into rx_fifo at rx_fifo_head
+ * If the FIFO is full, drop the byte and count it in rx_overrun_count
+ *
+ * Only rx_fifo_head is written here, so the main loop can pop bytes
+ * concurrently without a critical section.
  *
  * On transmit (TI):
- * Clear TI flag (not used for transmission in this application)
+ * Clear TI flag and uart_tx_busy (byte has left SBUF)
  */
 
 void UART_ISR(void) interrupt 4
 {
+    uint8_t next_head;
+    uint8_t fill;
+    
     if (RI)
     {
         RI = 0;                 /* Clear receive interrupt flag */
-        tx_temp_byte = SBUF;    /* Copy received byte */
-        tx_flag = 1;            /* Signal main loop */
+        
+        next_head = (rx_fifo_head + 1) & RX_FIFO_MASK;
+        
+        if (next_head != rx_fifo_tail)
+        {
+#if TX_INSTRUMENT
+            /* Arrival into an empty FIFO: start of STAT_HANDOFF */
+            if (rx_fifo_head == rx_fifo_tail)
+            {
+                STAMP_READ(rx_stamp);
+                rx_stamp_valid = 1;
+            }
+#endif
+            rx_fifo[rx_fifo_head] = SBUF;   /* Copy received byte */
+            rx_fifo_head = next_head;       /* Publish it to main loop */
+            
+            fill = RX_FIFO_COUNT();
+            if (fill > rx_fifo_peak)
+            {
+                rx_fifo_peak = fill;
+            }
+        }
+        else if (rx_overrun_count < 255)
+        {
+            rx_overrun_count++;             /* FIFO full: byte is lost */
+        }
     }
     if (TI)
     {
         TI = 0;                 /* Clear transmit interrupt flag */
+        uart_tx_busy = 0;       /* uart_putc() may load the next byte */
+    }
+}
+
+/* Timer1_ISR
+ * Timer 1 Interrupt Service Routine (Interrupt 3).
+ * Counts timer1_ticks (control sequence timeout, tx_handler.c), counts
+ * down the baud confirmation timeout and raises baud_revert_flag for the
+ * main loop when it expires.
+ * TX_INSTRUMENT: the Timer 1 count at entry is the delay since the
+ * overflow; the largest one is kept in irq_latency_max.
+ */
+
+void Timer1_ISR(void) interrupt 3
+{
+#if TX_INSTRUMENT
+    uint8_t late_hi;
+    uint16_t late;
+    
+    do
+    {
+        late_hi = TH1;
+        late = ((uint16_t)late_hi << 8) | TL1;
+    } while (late_hi != TH1);
+    
+    if (late > irq_latency_max)
+    {
+        irq_latency_max = late;
+    }
+    
+#endif
+    timer1_ticks++;
+    
+    if (baud_confirm_ticks != 0)
+    {
+        baud_confirm_ticks--;
+        if (baud_confirm_ticks == 0)
+        {
+            baud_revert_flag = 1;
+        }
     }
 }
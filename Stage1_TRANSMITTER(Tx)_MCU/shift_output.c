@@ -16,6 +16,18 @@
  * Shift order: MSB-first (bit 14 down to bit 0).
  * First bit shifted ends up at QH of second chip, last bit at QA of first chip.
  *
+ * AUX PARITY LINE (TX_AUX_PARITY):
+ *   Bit N (R = 4: bit 15 <=> QH of second 74HC595) is the parity of the
+ *   N lines, added by shift_out_state(). TX_SHIFT_BITS = N + 1 bits are
+ *   then shifted, starting with the aux bit.
+ *
+ * OTHER HAMMING_R WIDTHS:
+ * The same mapping continues with SHIFT_CHAIN_CHIPS chips (bit j on output
+ * j % 8 of chip j / 8). Only bits 0..N-1 are shifted, MSB-first, so bit 0
+ * always ends up on QA of the first chip:
+ *   R = 2: bits 0..2  on one chip     R = 4: bits 0..14 on two chips
+ *   R = 3: bits 0..6  on one chip     R = 5: bits 0..30 on four chips
+ *
  * 74HC595 TIMING (from datasheet @ VCC=4.5V):
  *   - fmax (SRCLK): 25 MHz
  *   - tsu (SER before SRCLK↑): 25 ns min
@@ -23,14 +35,41 @@
  *   - tsu (SRCLK↑ before RCLK↑): 19 ns min
  *   - tw (SRCLK/RCLK high or low): 20 ns min
  *
- * CLK TIMING ANALYSIS:
+ * CLK TIMING ANALYSIS (Shift Clock Timing in header.h):
  *
- * Target CLK frequency: ~100 kHz (conservative, well within 74HC595 specs)
+ * Target CLK frequency: SRCLK_HZ, default ~100 kHz (conservative, well
+ * within 74HC595 specs)
  * 
- * NOP-based delay calibration:
- *   - Each _nop_() is 1 cycle ≈ 90 ns
- *   - 55 NOPs ≈ 4.95 µs ≈ 5 µs
- *   - Use 55 NOPs for each half-period to achieve ~100 kHz CLK
+ * NOP-based delay, generated from CORE_CLK_HZ and SRCLK_HZ:
+ *   - Each _nop_() is 1 core cycle ≈ 90 ns @ 11.0592 MHz
+ *   - SRCLK_HALF_NOPS = 11059200 / (2 * 100000) = 55 NOPs ≈ 4.97 µs
+ *   - SETUP_NOPS = 25 ns tsu rounded up to core cycles = 1 NOP
+ *   - SRCLK_HZ = 0: no NOPs; each instruction (>= 1 cycle, ~90 ns) covers
+ *     the 20 ns / 25 ns minimums on its own
+ *
+ * SPLIT TOPOLOGY (SHIFT_TOPOLOGY == SHIFT_TOPOLOGY_SPLIT):
+ *   Chips are not chained and each has its own SRCLK (header.h). The same
+ *   bit mapping holds, but every chip is loaded with its own byte,
+ *   MSB-first, and only when that byte changed.
+ *
+ * TWO LANES (TX_LANES == 2):
+ *   Lane B has its own chain with the same bit mapping, fed from
+ *   SER_B_PIN. Both SER pins are set before each shared SRCLK edge, so the
+ *   two chains load in the time of one and latch on the same RCLK edge.
+ *
+ * PIPELINED LATCH (TX_PIPELINE):
+ *   The 74HC595 shift register is separate from its output latch. The
+ *   next state is shifted in while the current one is still displayed,
+ *   and Timer 2 pulses RCLK at a fixed symbol rate (TX_PIPE_RATE_HZ).
+ *
+ * SPI DRIVER (SHIFT_DRIVER == SHIFT_DRIVER_SPI):
+ *   The on-chip SPI master replaces the NOP loop. MOSI drives SER and SCLOCK
+ *   drives SRCLK. The state goes out as SHIFT_CHAIN_CHIPS bytes, MSB-first,
+ *   so for R = 4 bit 15 (aux line or unused) lands on QH of the second chip and bit 0 on
+ *   QA of the first chip, the same mapping as the bit-bang order above.
+ *   CPOL = 0, CPHA = 0: SER changes on the falling SCLOCK edge and is stable
+ *   on the rising edge the 74HC595 samples.
+ *   At fcore/2 an R = 4 update is 16 SCLOCK periods (~3 us) plus the RCLK pulse.
  *
  */
 
@@ -38,22 +77,44 @@
 #include <intrins.h>  /* For _nop_() */
 #include "header.h"
 
+#if (SHIFT_DRIVER == SHIFT_DRIVER_BITBANG)
+
 /* NOP delay macros for CLK timing
- * Assuming 11.0592 MHz CPU, each NOP ≈ 90 ns
- * Target: 55 NOPs ≈ 5 µs delay for ~100 kHz CLK
- * (100 kHz = 10 µs period, 5 µs per half-period)
+ * NOP_DELAY(n): n NOPs for a constant n = 0..255, one branch per bit of
+ * n. The conditions are constants, so the compiler keeps only the NOPs
+ * of the bits that are set.
+ * CLK_DELAY_NOPS(): one SRCLK half-period (SRCLK_HALF_NOPS, 55 NOPs ≈ 5 µs
+ * for 100 kHz @ 11.0592 MHz)
+ * SETUP_DELAY(): 74HC595 tsu before a clock edge (SETUP_NOPS)
  */
-#define CLK_DELAY_NOPS() do { \
-    _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); \
-    _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); \
-    _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); \
-    _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); \
-    _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); \
-    _nop_(); _nop_(); _nop_(); _nop_(); _nop_(); \
+#define NOP2()      _nop_(); _nop_()
+#define NOP4()      NOP2(); NOP2()
+#define NOP8()      NOP4(); NOP4()
+#define NOP16()     NOP8(); NOP8()
+#define NOP32()     NOP16(); NOP16()
+#define NOP64()     NOP32(); NOP32()
+#define NOP128()    NOP64(); NOP64()
+
+#define NOP_DELAY(n) do { \
+    if ((n) & 0x01) { _nop_(); } \
+    if ((n) & 0x02) { NOP2(); } \
+    if ((n) & 0x04) { NOP4(); } \
+    if ((n) & 0x08) { NOP8(); } \
+    if ((n) & 0x10) { NOP16(); } \
+    if ((n) & 0x20) { NOP32(); } \
+    if ((n) & 0x40) { NOP64(); } \
+    if ((n) & 0x80) { NOP128(); } \
 } while(0)
 
-/* output_to_shift_registers
- * Bit-bangs current_bus_state (15 bits) to chained 74HC595 shift registers.
+#define CLK_DELAY_NOPS()    NOP_DELAY(SRCLK_HALF_NOPS)
+#define SETUP_DELAY()       NOP_DELAY(SETUP_NOPS)
+
+#if (SHIFT_TOPOLOGY == SHIFT_TOPOLOGY_CHAIN)
+
+/* shift_load
+ * Bit-bangs a bus state (N bits) into chained 74HC595 shift registers.
+ * The outputs do not change until RCLK is pulsed (shift_chain or, with
+ * TX_PIPELINE, Timer2_ISR).
  *
  * 74HC595 Pin Mapping:
  *   SER_PIN   -> SER (pin 14)   - Serial data input
@@ -61,56 +122,158 @@
  *   RCLK_PIN  -> RCLK (pin 12)  - Storage register clock (rising edge triggered)
  *
  * Protocol sequence (per 74HC595 datasheet):
- * 1. For each bit (MSB-first, bit 14 down to bit 0):
+ * For each bit (MSB-first, bit N-1 down to bit 0):
  *    a. Set SER_PIN to the bit value
  *    b. Pulse SRCLK_PIN high then low - data shifts on rising edge
- * 2. After all bits shifted, pulse RCLK_PIN high then low
- *    - This transfers shift register contents to output latches on rising edge
  *
  * Note: RCLK and SRCLK are independent. RCLK doesn't need to be held low
  * during shifting - only the rising edge matters for latching.
  *
- * Interrupt safety: Disables interrupts during bit-bang to ensure timing
- * consistency and atomic bus state output. Re-enables after completion.
+ * TX_LANES == 2: lane B (state bits 16..30) goes out on SER_B_PIN with
+ * the same SRCLK edges.
  */
-void output_to_shift_registers(void)
+static void shift_load(tx_word_t state)
 {
-    uint16_t state_copy;
-    signed char bit_pos;  /* Signed for loop decrement below zero */
-    uint8_t saved_ea;
+    bus_state_t state_copy;
+    uint8_t bit_count;
+#if (TX_LANES == 2)
+    bus_state_t lane_b;
     
-    /* === Begin Critical Section === */
-    /* Save and disable interrupts for atomic, timing-consistent output */
-    saved_ea = EA;
-    EA = 0;
+    lane_b = (bus_state_t)(state >> 16) & BUS_STATE_MASK;
+#endif
     
     /* Make local copy of bus state (won't change during output) */
-    state_copy = current_bus_state & BUS_STATE_MASK;
+    state_copy = (bus_state_t)state & TX_SHIFT_MASK;
     
-    /* Step 1: Shift out 15 bits, MSB-first (bit 14 down to bit 0) */
+    /* Shift out N bits (N + 1 with the aux line), MSB-first */
     /* Data is clocked into 74HC595 shift register on SRCLK rising edge */
-    for (bit_pos = (HAMMING_N - 1); bit_pos >= 0; bit_pos--)
+    for (bit_count = TX_SHIFT_BITS; bit_count != 0; bit_count--)
     {
-        /* 1a. Set SER_PIN to current bit value */
-        SER_PIN = (uint8_t)((state_copy >> bit_pos) & 0x0001);
+        /* a. Set SER_PIN to current bit value (top bus line), then move the
+         * next line up. A constant mask and a 1-bit shift avoid the variable
+         * shift count, which the 8051 has to do as a loop. */
+        SER_PIN = (state_copy & TX_SHIFT_MSB) ? 1 : 0;
+        state_copy <<= 1;
+#if (TX_LANES == 2)
+        SER_B_PIN = (lane_b & BUS_STATE_MSB) ? 1 : 0;
+        lane_b <<= 1;
+#endif
         
         /* Small setup time for data before clock edge (tsu = 25ns min @ 4.5V) */
-        _nop_(); _nop_();
+        SETUP_DELAY();
         
-        /* 1b. SRCLK rising edge - data shifts in */
+        /* b. SRCLK rising edge - data shifts in */
         SRCLK_PIN = 1;
-        CLK_DELAY_NOPS();  /* ~5 µs high time for 100 kHz CLK */
+        CLK_DELAY_NOPS();  /* Half-period high time (~5 µs for 100 kHz CLK) */
         
-        /* 1c. SRCLK falling edge */
+        /* SRCLK falling edge */
         SRCLK_PIN = 0;
-        CLK_DELAY_NOPS();  /* ~5 µs low time */
+        CLK_DELAY_NOPS();  /* Half-period low time */
+    }
+}
+
+#else /* SHIFT_TOPOLOGY_SPLIT */
+
+/* Value in each chip's shift register (not its outputs). Invalid until
+ * the first update, so that every chip is loaded once. */
+static bus_state_t split_loaded = 0;
+static bit split_valid = 0;
+
+/* shift_chip
+ * Bit-bangs 8 bits, MSB-first, into the one chip whose SRCLK is clk_mask.
+ * Bit 7 ends up on QH, bit 0 on QA. SER_PIN is shared, the other chips
+ * see no clock edge and keep their contents.
+ */
+static void shift_chip(uint8_t value, uint8_t clk_mask)
+{
+    uint8_t bit_count;
+    
+    for (bit_count = 8; bit_count != 0; bit_count--)
+    {
+        SER_PIN = (value & 0x80) ? 1 : 0;
+        value <<= 1;
+        
+        /* Small setup time for data before clock edge */
+        SETUP_DELAY();
+        
+        /* SRCLK rising edge on this chip only (ORL/ANL on the P2 latch) */
+        P2 |= clk_mask;
+        CLK_DELAY_NOPS();
+        
+        P2 &= ~clk_mask;
+        CLK_DELAY_NOPS();
+    }
+}
+
+/* shift_load
+ * Split topology: loads only the chips whose byte differs from what their
+ * shift register already holds. The outputs change on the next RCLK.
+ *
+ * 1. diff = state ^ split_loaded (all bits on the first update)
+ * 2. For each chip with a non-zero diff byte: shift_chip() its byte
+ * On RCLK, changed chips show the new byte and the others re-latch the
+ * byte they already display.
+ */
+static void shift_load(bus_state_t state)
+{
+    bus_state_t diff;
+    
+    state &= TX_SHIFT_MASK;
+    diff = split_valid ? (state ^ split_loaded) : TX_SHIFT_MASK;
+    
+    /* Byte per chip, unrolled for SHIFT_CHAIN_CHIPS */
+#if (SHIFT_CHAIN_CHIPS == 4)
+    if ((uint8_t)(diff >> 24))
+    {
+        shift_chip((uint8_t)(state >> 24), SPLIT_SRCLK_MASK(3));
+    }
+    if ((uint8_t)(diff >> 16))
+    {
+        shift_chip((uint8_t)(state >> 16), SPLIT_SRCLK_MASK(2));
+    }
+#endif
+#if (SHIFT_CHAIN_CHIPS >= 2)
+    if ((uint8_t)(diff >> 8))
+    {
+        shift_chip((uint8_t)(state >> 8), SPLIT_SRCLK_MASK(1));
+    }
+#endif
+    if ((uint8_t)diff)
+    {
+        shift_chip((uint8_t)state, SPLIT_SRCLK_MASK(0));
     }
     
+    split_loaded = state;
+    split_valid = 1;
+}
+
+#endif /* SHIFT_TOPOLOGY */
+
+#if !TX_PIPELINE
+/* shift_chain
+ * Loads a bus state (shift_load) and latches it onto the outputs.
+ *
+ * 1. shift_load(): N bits (chain) or the changed chips (split)
+ * 2. After all bits shifted, pulse RCLK_PIN high then low
+ *    - This transfers shift register contents to output latches on rising edge
+ *
+ * Interrupt safety: No critical section is needed. The outputs change
+ * only on the RCLK edge, so an ISR between two bits merely stretches one
+ * SRCLK phase (the 74HC595 is static, there is no minimum clock rate), and
+ * no ISR touches the P2 shift pins in this mode. Every pin write is a
+ * single SETB/CLR, so UART_ISR latency stays a few instructions instead of
+ * the whole N-bit shift.
+ */
+static void shift_chain(tx_word_t state)
+{
+    /* Step 1: Shift register load */
+    shift_load(state);
+    
     /* Step 2: Pulse RCLK to transfer shift register to output latches */
     /* 74HC595 latches data on RCLK rising edge */
     
     /* Small delay after last SRCLK before RCLK (tsu: SRCLK↑ before RCLK↑ = 19ns min @ 4.5V) */
-    _nop_(); _nop_(); _nop_();
+    SETUP_DELAY();
     
     /* RCLK rising edge - transfers shift register to storage register */
     RCLK_PIN = 1;
@@ -118,17 +281,245 @@ void output_to_shift_registers(void)
     
     /* RCLK falling edge - prepare for next transfer */
     RCLK_PIN = 0;
+}
+#endif
+
+#elif (SHIFT_DRIVER == SHIFT_DRIVER_SPI)
+
+/* SPICON bit values (ADuC841 datasheet) */
+#define SPICON_SPE      0x20    /* SPI enable (cleared = I2C interface) */
+#define SPICON_SPIM     0x10    /* Master mode */
+#define SPICON_CPOL     0x08    /* SCLOCK idles high when set */
+#define SPICON_CPHA     0x04    /* Data changes on leading edge when set */
+
+/* spi_send_byte
+ * Writes one byte to SPIDAT and waits for ISPI (end of transfer).
+ * Polling is shorter than the transfer setup of an ISR at fcore/2.
+ */
+static void spi_send_byte(uint8_t value)
+{
+    SPIDAT = value;     /* Writing SPIDAT starts the transfer */
+    while (!ISPI);      /* 8 SCLOCK periods */
+    ISPI = 0;
+}
+
+/* shift_load
+ * Sends a bus state into the chained 74HC595s through the SPI master,
+ * without latching it.
+ *
+ * Protocol sequence:
+ * 1. Upper bytes to SPIDAT, one per extra chip, last chip first
+ *    (R = 4: bits 15..8), waiting for ISPI after each
+ * 2. Low byte (bits 7..0) to SPIDAT, wait for ISPI
+ */
+static void shift_load(bus_state_t state)
+{
+    bus_state_t state_copy;
+    
+    state_copy = state & TX_SHIFT_MASK;
     
-    /* === End Critical Section === */
-    EA = saved_ea;  /* Restore interrupt state */
+    /* Step 1 + 2: MSB-first, highest byte lands in the last chip.
+     * Unrolled for the chain length selected by HAMMING_R. */
+#if (SHIFT_CHAIN_CHIPS == 4)
+    spi_send_byte((uint8_t)(state_copy >> 24));
+    spi_send_byte((uint8_t)(state_copy >> 16));
+#endif
+#if (SHIFT_CHAIN_CHIPS >= 2)
+    spi_send_byte((uint8_t)(state_copy >> 8));
+#endif
+    spi_send_byte((uint8_t)state_copy);
+}
+
+#if !TX_PIPELINE
+/* shift_chain
+ * shift_load(), then pulse RCLK_PIN high then low to latch the outputs.
+ *
+ * Interrupt safety: No critical section is needed. The state is passed by
+ * value and no ISR touches SPIDAT or RCLK_PIN in this mode, so the whole
+ * update runs with interrupts enabled.
+ */
+static void shift_chain(bus_state_t state)
+{
+    shift_load(state);
+    
+    /* RCLK rising edge transfers shift register to output latches.
+     * tsu (SRCLK before RCLK) = 19 ns and tw = 20 ns are covered by one
+     * instruction cycle each. */
+    RCLK_PIN = 1;
+    _nop_();
+    RCLK_PIN = 0;
+}
+#endif
+
+#else
+#error "SHIFT_DRIVER must be SHIFT_DRIVER_BITBANG or SHIFT_DRIVER_SPI"
+#endif
+
+#if TX_SKIP_UNCHANGED
+/* Value in the 74HC595 output latches (with TX_PIPELINE: in the shift
+ * registers, latched at the next tick). Invalid until the first update,
+ * because the chips power up with random outputs. */
+static tx_word_t latched_state = 0;
+static bit latched_valid = 0;
+#endif
+
+#if TX_PIPELINE
+/* Set by shift_out_state() once the next symbol is ready, cleared by
+ * Timer2_ISR when it has latched and strobed it. */
+static volatile bit pipe_pending = 0;
+
+#if TX_SKIP_UNCHANGED
+/* The waiting symbol is a new state in the shift registers: pulse RCLK.
+ * Clear for a skipped repeat, which only gets the strobe. */
+static bit pipe_latch = 0;
+#endif
+
+/* Timer2_Init
+ * Timer 2 in 16-bit auto-reload mode as the symbol clock: one overflow
+ * (interrupt 5) every TX_PIPE_TICKS counts.
+ */
+void Timer2_Init(void)
+{
+    T2CON = 0x00;                               /* Auto-reload, timer, stopped */
+    RCAP2H = (uint8_t)(TX_PIPE_RELOAD >> 8);
+    RCAP2L = (uint8_t)TX_PIPE_RELOAD;
+    TH2 = RCAP2H;
+    TL2 = RCAP2L;
+    ET2 = 1;                                    /* Enable Timer 2 interrupt */
+    TR2 = 1;                                    /* Start symbol clock */
+}
+
+/* Timer2_ISR
+ * Symbol clock tick. If a symbol is waiting, latch the shift registers
+ * (not for a TX_SKIP_UNCHANGED repeat) and pulse the symbol strobe;
+ * otherwise this tick carries no symbol and the outputs keep showing the
+ * last one.
+ */
+void Timer2_ISR(void) interrupt 5
+{
+    TF2 = 0;        /* Not cleared by hardware */
+    
+    if (pipe_pending)
+    {
+#if TX_SKIP_UNCHANGED
+        if (pipe_latch)
+        {
+            RCLK_PIN = 1;
+            _nop_();
+            RCLK_PIN = 0;
+            pipe_latch = 0;
+        }
+#else
+        RCLK_PIN = 1;
+        _nop_();
+        RCLK_PIN = 0;
+#endif
+        
+#if TX_SYMBOL_STROBE
+        STROBE_PIN = 1;
+        _nop_(); _nop_();
+        STROBE_PIN = 0;
+#endif
+        
+        pipe_pending = 0;
+    }
+}
+#endif
+
+/* shift_out_state
+ * Puts a bus state on the 74HC595 outputs and marks it as a new symbol.
+ *
+ * 1. TX_SKIP_UNCHANGED: if the state equals the latched one (w = 0, a
+ *    repeated symbol), skip the shift/latch cycle; the outputs already
+ *    show it and an identical re-latch would only cost time
+ * 2. Otherwise shift and latch it (shift_chain)
+ * 3. TX_SYMBOL_STROBE: pulse STROBE_PIN high then low, once per symbol
+ *    whether or not the bus changed, so the receiver can count repeats
+ * TX_AUX_PARITY: before step 1, bit N is set to the parity of the lines.
+ *
+ * TX_PIPELINE: the state is only loaded into the shift registers (after
+ * the previous one was latched); Timer2_ISR pulses RCLK and the strobe on
+ * the next symbol clock tick, only the strobe for a skipped repeat. The load runs with interrupts enabled: the
+ * 74HC595 is static, so a stretched SRCLK period is harmless, and the
+ * symbol timing no longer depends on the shift.
+ */
+void shift_out_state(tx_word_t state)
+{
+    state &= TX_WORD_MASK;
+    
+#if TX_AUX_PARITY
+    /* Aux line: even parity over lines + aux */
+    if (bus_parity(state))
+    {
+        state |= TX_AUX_BIT;
+    }
+#endif
+    
+#if TX_PIPELINE
+    /* Wait until the previous state has been latched; its shift register
+     * contents may be overwritten only after the RCLK edge */
+    while (pipe_pending);
+    
+#if TX_SKIP_UNCHANGED
+    if (!latched_valid || state != latched_state)
+    {
+        shift_load(state);
+        latched_state = state;
+        latched_valid = 1;
+        pipe_latch = 1;
+    }
+#else
+    shift_load(state);
+#endif
+    
+    /* Latch (new state only) and strobe at the next Timer 2 tick */
+    pipe_pending = 1;
+#else
+    
+#if TX_SKIP_UNCHANGED
+    if (!latched_valid || state != latched_state)
+    {
+        shift_chain(state);
+        latched_state = state;
+        latched_valid = 1;
+    }
+#else
+    shift_chain(state);
+#endif
+    
+#if TX_SYMBOL_STROBE
+    /* Two instruction cycles high: INT0 edge detection needs the level
+     * to be held for at least one cycle on either side of the edge */
+    STROBE_PIN = 1;
+    _nop_(); _nop_();
+    STROBE_PIN = 0;
+#endif
+#endif /* TX_PIPELINE */
+}
+
+/* output_to_shift_registers
+ * Displays current_bus_state on the bus (see shift_out_state).
+ * TX_LANES == 2: lane B shows current_bus_state_b in the same latch.
+ */
+void output_to_shift_registers(void)
+{
+#if (TX_LANES == 2)
+    shift_out_state(TX_WORD(current_bus_state, current_bus_state_b));
+#else
+    shift_out_state(current_bus_state);
+#endif
 }
 
 /* Port_Init
  * Initialize GPIO pins for 74HC595 shift register interface.
+ * With SHIFT_DRIVER_SPI the SPI master is also configured here.
  * Pin initialization:
  *   SER_PIN (DATA)   - LOW (no data)
  *   SRCLK_PIN (CLK)  - LOW (ready for rising edge)
  *   RCLK_PIN (LATCH) - LOW (ready for rising edge)
+ *   Split SRCLKs     - LOW (SHIFT_TOPOLOGY_SPLIT)
+ *   STROBE_PIN       - LOW (TX_SYMBOL_STROBE)
+ *   SER_B_PIN        - LOW (TX_LANES == 2)
  *
  */
 void Port_Init(void)
@@ -137,4 +528,19 @@ void Port_Init(void)
     SER_PIN   = 0;   /* Serial data input - idle low */
     SRCLK_PIN = 0;   /* Shift register clock - idle low */
     RCLK_PIN  = 0;   /* Storage register clock - idle low */
+#if (SHIFT_TOPOLOGY == SHIFT_TOPOLOGY_SPLIT)
+    P2 &= ~SPLIT_SRCLK_ALL;  /* Per-chip shift clocks - idle low */
+#endif
+#if TX_SYMBOL_STROBE
+    STROBE_PIN = 0;  /* Symbol strobe - idle low, falling edge = new symbol */
+#endif
+#if (TX_LANES == 2)
+    SER_B_PIN = 0;   /* Lane B serial data - idle low */
+#endif
+    
+#if (SHIFT_DRIVER == SHIFT_DRIVER_SPI)
+    /* SPI master, mode 0 (CPOL = 0, CPHA = 0), rate from SPI_RATE_SEL */
+    SPICON = SPICON_SPE | SPICON_SPIM | (SPI_RATE_SEL & 0x03);
+    ISPI = 0;
+#endif
 }
\ No newline at end of file
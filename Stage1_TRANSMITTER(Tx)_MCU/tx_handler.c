@@ -9,37 +9,381 @@
  * TRANSMISSION ORDER: HIGH nibble first, then LOW nibble.
  * Each nibble is processed as an independent S_new (4-bit syndrome).
  *
+ * OTHER HAMMING_R WIDTHS:
+ * For R != 4 the byte stream is cut into R-bit symbols, MSB-first:
+ *   R = 2: four symbols per character (bits 7..6, 5..4, 3..2, 1..0)
+ *   R = 3, 5: the stream does not divide evenly into bytes, so leftover bits
+ *            are carried into the next character (sym_acc/sym_bits below).
+ * The path is chosen at compile time; there is no run-time test of R.
+ *
+ * TWO LANES (TX_LANES == 2, R = 4):
+ * Both nibbles of a character go out in ONE symbol period: the high
+ * nibble on lane A, the low nibble on lane B, latched together.
+ *
  * TERMINATOR HANDLING:
  * '\r' (0x0D) and '\n' (0x0A) are treated as batch terminators.
  * They set buffer_flag for compatibility with the original codebase.
  * They do NOT generate nibble transmissions.
  *
+ * CONTROL BYTES:
+ * CTRL_BAUD, <index> switches the UART rate (handshake in header.h).
+ *
+ * BURST FRAMES (TX_BURST_ENABLE):
+ * CTRL_BURST, <len>, <len bytes> sends the payload as one burst: all of its
+ * bus states are computed first and then latched back-to-back.
+ * Inside the payload every byte is data, including '\r' and '\n'.
+ *
+ * STATISTICS (TX_INSTRUMENT, TX_TOGGLE_STATS):
+ * CTRL_STATS, <clear> dumps the stage timings of tx_stats.c.
+ * CTRL_TOGGLES, <clear> dumps the switching-activity counters.
+ *
+ * CREDIT FLOW CONTROL (TX_CREDIT_ENABLE):
+ * CTRL_CREDIT starts credit reporting; credit_report() then hands consumed
+ * FIFO bytes back to the host in CTRL_CREDIT, <n> replies.
+ *
+ * RESYNC (TX_RESYNC_ENABLE):
+ * CTRL_RESYNC, and every TX_RESYNC_INTERVAL data bytes, returns the bus
+ * to the all-zero state with a marker the receiver recognizes.
+ *
  */
 
 #include <aduc841.h>
 #include "header.h"
 
+#if (HAMMING_R == 3) || (HAMMING_R == 5)
+/* Bit carry between characters for symbol widths that do not divide 8.
+ * Holds the sym_bits (< HAMMING_R) oldest unsent bits, right-aligned. */
+static uint16_t sym_acc = 0;
+static uint8_t sym_bits = 0;
+#endif
+
+#if TX_BURST_ENABLE
+/* Burst collection: while burst_collect is set, emit_symbol() stores the
+ * encoded bus states here instead of latching them. */
+static bit burst_collect = 0;
+static uint8_t burst_count = 0;
+static tx_word_t idata burst_states[TX_BURST_MAX_SYMBOLS];
+#endif
+
+#if TX_CREDIT_ENABLE
+/* Credit reporting: credit_tail is the FIFO read index up to which
+ * consumed bytes have been reported to the host. */
+static bit credit_enabled = 0;
+static uint8_t credit_tail = 0;
+#endif
+
+#if TX_RESYNC_ENABLE && TX_RESYNC_INTERVAL
+/* Data bytes encoded since the last resync */
+static uint16_t resync_count = 0;
+#endif
+
+/* fifo_wait
+ * Waits until rx_fifo holds at least count bytes of a control sequence.
+ * Returns 0 if no new byte arrived for TX_FRAME_TIMEOUT_TICKS Timer 1
+ * overflows: the queued bytes are the start of a broken sequence and are
+ * dropped, and the caller returns to the main loop.
+ */
+static bit fifo_wait(uint8_t count)
+{
+    uint8_t fill;
+    uint8_t start;
+    
+    fill = RX_FIFO_COUNT();
+    start = timer1_ticks;
+    
+    while (fill < count)
+    {
+        if (RX_FIFO_COUNT() != fill)
+        {
+            /* The timeout counts from the last byte received */
+            fill = RX_FIFO_COUNT();
+            start = timer1_ticks;
+        }
+        else if ((uint8_t)(timer1_ticks - start) >= TX_FRAME_TIMEOUT_TICKS)
+        {
+            rx_fifo_tail = rx_fifo_head;
+            return 0;
+        }
+    }
+    
+    return 1;
+}
+
+/* fifo_pop
+ * Pops one byte; the FIFO must not be empty (fifo_wait first).
+ */
+static uint8_t fifo_pop(void)
+{
+    uint8_t value;
+    
+    RX_FIFO_POP(value);
+    
+    return value;
+}
+
+#if (TX_LANES == 1)
+/* emit_symbol
+ * Sends one R-bit symbol: straight to the bus, or into the burst buffer
+ * while a burst is being collected.
+ */
+static void emit_symbol(uint8_t symbol)
+{
+#if TX_BURST_ENABLE
+    if (burst_collect)
+    {
+        encode_nibble(symbol);
+        burst_states[burst_count++] = current_bus_state;
+        return;
+    }
+#endif
+    process_nibble(symbol);
+}
+#else
+/* emit_lanes
+ * Sends one data character as one symbol on each lane. Lane B is encoded
+ * first, so process_nibble() latches both new states together.
+ */
+static void emit_lanes(uint8_t rx_char)
+{
+    encode_nibble_b(rx_char & 0x0F);
+    
+#if TX_BURST_ENABLE
+    if (burst_collect)
+    {
+        encode_nibble(rx_char >> 4);
+        burst_states[burst_count++] = TX_WORD(current_bus_state, current_bus_state_b);
+        return;
+    }
+#endif
+    process_nibble(rx_char >> 4);
+}
+#endif
+
+/* encode_char
+ * Splits one data character into R-bit symbols, MSB-first, and emits them.
+ *
+ * R = 4:
+ * 1. Extract high nibble: (rx_char >> 4) & 0x0F
+ * 2. Extract low nibble:  rx_char & 0x0F
+ * 3. Process high nibble first
+ * 4. Process low nibble second
+ * (R != 4: R-bit symbols, MSB-first, as described at the top of this file;
+ * TX_LANES == 2: both nibbles at once, emit_lanes())
+ */
+static void encode_char(uint8_t rx_char)
+{
+#if (TX_LANES == 2)
+    /* High nibble on lane A, low nibble on lane B, one latch */
+    emit_lanes(rx_char);
+    
+    if (buffer_count < 255)
+    {
+        buffer_count += 2;  /* Two nibbles processed */
+    }
+#elif (HAMMING_R == 4)
+    uint8_t high_nibble;
+    uint8_t low_nibble;
+    
+    /* Step 1: Extract high nibble (bits 7..4) */
+    high_nibble = (rx_char >> 4) & 0x0F;
+    
+    /* Step 2: Extract low nibble (bits 3..0) */
+    low_nibble = rx_char & 0x0F;
+    
+    /* Step 3: Process HIGH nibble FIRST (per specification) */
+    emit_symbol(high_nibble);
+    
+    /* Step 4: Process LOW nibble SECOND */
+    emit_symbol(low_nibble);
+    
+    /* Increment buffer count for tracking (optional, for debugging/stats) */
+    if (buffer_count < 255)
+    {
+        buffer_count += 2;  /* Two nibbles processed */
+    }
+#elif (HAMMING_R == 2)
+    /* Four 2-bit symbols, most significant pair first */
+    emit_symbol(rx_char >> 6);
+    emit_symbol(rx_char >> 4);
+    emit_symbol(rx_char >> 2);
+    emit_symbol(rx_char);       /* encode_nibble() masks to R bits */
+    
+    if (buffer_count < 252)
+    {
+        buffer_count += 4;  /* Four symbols processed */
+    }
+#else
+    /* Append the 8 new bits below the carried ones, then emit every
+     * complete R-bit symbol from the top */
+    sym_acc = (sym_acc << 8) | rx_char;
+    sym_bits += 8;
+    
+    while (sym_bits >= HAMMING_R)
+    {
+        sym_bits -= HAMMING_R;
+        emit_symbol((uint8_t)(sym_acc >> sym_bits));
+        
+        if (buffer_count < 255)
+        {
+            buffer_count++;
+        }
+    }
+    
+    /* Keep only the bits not yet sent */
+    sym_acc &= ((uint16_t)1 << sym_bits) - 1;
+#endif
+    
+#if TX_RESYNC_ENABLE && TX_RESYNC_INTERVAL
+    if (resync_count < 0xFFFF)
+    {
+        resync_count++;
+    }
+#endif
+}
+
+#if TX_RESYNC_ENABLE
+/* resync_bus
+ * Returns the bus to the all-zero state (see Bus Resync in header.h).
+ *
+ * 1. R = 3, 5: send the carried bits as one zero-padded symbol
+ * 2. Lane A with 0 or 1 high lines: latch it ^ TX_RESYNC_PREP first, a
+ *    multi-line change with the same syndrome, so that step 3 toggles at
+ *    least two lines
+ * 3. Latch the all-zero state (both lanes) and reset the syndrome caches
+ * Never called while a burst is being collected.
+ */
+static void resync_bus(void)
+{
+    bus_state_t prep;
+    
+#if (HAMMING_R == 3) || (HAMMING_R == 5)
+    /* Step 1: no data bit may be lost with the carry */
+    if (sym_bits != 0)
+    {
+        process_nibble((uint8_t)(sym_acc << (HAMMING_R - sym_bits)));
+        sym_acc = 0;
+        sym_bits = 0;
+    }
+#endif
+    
+    /* Step 2: x & (x - 1) == 0 means at most one line is high */
+    prep = current_bus_state;
+    if ((prep & (prep - 1)) == 0)
+    {
+        prep ^= TX_RESYNC_PREP;
+#if (TX_LANES == 2)
+        shift_out_state(TX_WORD(prep, current_bus_state_b));
+#else
+        shift_out_state(prep);
+#endif
+    }
+    
+    /* Step 3: every high line toggles once */
+    current_bus_state = 0;
+    current_syndrome = 0;
+#if (TX_LANES == 2)
+    current_bus_state_b = 0;
+    current_syndrome_b = 0;
+#endif
+    output_to_shift_registers();
+    
+#if TX_RESYNC_INTERVAL
+    resync_count = 0;
+#endif
+}
+
+#if TX_RESYNC_INTERVAL
+/* resync_check
+ * Periodic resync once TX_RESYNC_INTERVAL data bytes were sent. Called
+ * between characters and between bursts.
+ */
+static void resync_check(void)
+{
+    if (resync_count >= TX_RESYNC_INTERVAL)
+    {
+        resync_bus();
+    }
+}
+#endif
+#endif
+
+#if TX_BURST_ENABLE
+/* run_burst
+ * Sends len (1..TX_BURST_MAX_BYTES) payload bytes as one burst.
+ *
+ * 1. Wait until all len bytes are in rx_fifo, so the latch sequence below
+ *    never stalls on the UART. Returns 0 on a timeout (fifo_wait), with
+ *    nothing encoded
+ * 2. Encode every symbol into burst_states[] (no bus activity)
+ * 3. Latch the states back-to-back, TX_BURST_GAP_LOOPS apart
+ */
+static bit run_burst(uint8_t len)
+{
+    uint8_t i;
+    volatile uint8_t gap;
+    
+    /* Step 1: Whole payload must be buffered */
+    if (!fifo_wait(len))
+    {
+        return 0;
+    }
+    
+    /* Step 2: Precompute bus states */
+    burst_count = 0;
+    burst_collect = 1;
+    
+    for (i = 0; i < len; i++)
+    {
+        encode_char(fifo_pop());
+    }
+    
+    burst_collect = 0;
+    
+    /* Step 3: Stream out with a fixed inter-latch time */
+    for (i = 0; i < burst_count; i++)
+    {
+        shift_out_state(burst_states[i]);
+        
+        for (gap = TX_BURST_GAP_LOOPS; gap != 0; gap--);
+    }
+    
+    return 1;
+}
+#endif
+
 /* tx_handler
  * Processes a single character received from UART.
  *
  * For printable/data characters:
- * 1. Extract high nibble: (rx_char >> 4) & 0x0F
- * 2. Extract low nibble:  rx_char & 0x0F
- * 3. Process high nibble first via process_nibble()
- * 4. Process low nibble second via process_nibble()
+ * - Split into symbols and encode via encode_char()
  *
  * For terminators ('\r', '\n'):
  * - Set buffer_flag = 1 (for legacy batch processing compatibility)
  * - Do NOT process as nibbles
  *
+ * For CTRL_BURST (TX_BURST_ENABLE):
+ * - Read <len> from rx_fifo, then send the next len bytes as bursts of up
+ *   to TX_BURST_MAX_BYTES each
+ *
+ * For CTRL_BAUD:
+ * - Read <index> from rx_fifo and run the baud handshake (baud_request)
+ *
+ * Argument bytes that do not arrive within TX_FRAME_TIMEOUT_MS drop the
+ * whole control sequence (fifo_wait).
+ *
+ * For CTRL_RESYNC (TX_RESYNC_ENABLE):
+ * - Return the bus to the all-zero state (resync_bus)
+ *
  * The process_nibble() function handles the full encode cycle:
  * S_old computation, S_target = S_new ^ S_old, minimal-w search,
  * differential update, and shift register output.
  */
 void tx_handler(uint8_t rx_char)
 {
-    uint8_t high_nibble;
-    uint8_t low_nibble;
+#if TX_BURST_ENABLE
+    uint8_t len;
+    uint8_t chunk;
+#endif
     
     /* --- Check for line terminators (batch boundary markers) --- */
     if (rx_char == '\r' || rx_char == '\n')
@@ -49,23 +393,129 @@ void tx_handler(uint8_t rx_char)
         return;
     }
     
-    /* --- Process data character --- */
+#if TX_BURST_ENABLE
+    /* --- Burst frame: CTRL_BURST, <len>, payload --- */
+    if (rx_char == CTRL_BURST)
+    {
+        if (!fifo_wait(1))
+        {
+            return;
+        }
+        len = fifo_pop();
+        
+        while (len != 0)
+        {
+            chunk = (len > TX_BURST_MAX_BYTES) ? TX_BURST_MAX_BYTES : len;
+            if (!run_burst(chunk))
+            {
+                return;     /* Truncated frame: the rest is lost */
+            }
+            len -= chunk;
+            
+#if TX_RESYNC_ENABLE && TX_RESYNC_INTERVAL
+            resync_check();
+#endif
+            
+#if TX_CREDIT_ENABLE
+            /* Long frames: the host needs credits before the frame ends */
+            credit_report();
+#endif
+        }
+        return;
+    }
+#endif
     
-    /* Step 1: Extract high nibble (bits 7..4) */
-    high_nibble = (rx_char >> 4) & 0x0F;
+#if TX_RESYNC_ENABLE
+    /* --- Resync request: back to the all-zero state --- */
+    if (rx_char == CTRL_RESYNC)
+    {
+        resync_bus();
+        return;
+    }
+#endif
     
-    /* Step 2: Extract low nibble (bits 3..0) */
-    low_nibble = rx_char & 0x0F;
+    /* --- Baud rate request: CTRL_BAUD, <index> --- */
+    if (rx_char == CTRL_BAUD)
+    {
+        if (fifo_wait(1))
+        {
+            baud_request(fifo_pop());
+        }
+        return;
+    }
     
-    /* Step 3: Process HIGH nibble FIRST (per specification) */
-    process_nibble(high_nibble);
+#if TX_INSTRUMENT
+    /* --- Statistics query: CTRL_STATS, <clear> --- */
+    if (rx_char == CTRL_STATS)
+    {
+        if (fifo_wait(1))
+        {
+            stats_dump(fifo_pop());
+        }
+        return;
+    }
+#endif
     
-    /* Step 4: Process LOW nibble SECOND */
-    process_nibble(low_nibble);
+#if TX_TOGGLE_STATS
+    /* --- Toggle counter query: CTRL_TOGGLES, <clear> --- */
+    if (rx_char == CTRL_TOGGLES)
+    {
+        if (fifo_wait(1))
+        {
+            toggles_dump(fifo_pop());
+        }
+        return;
+    }
+#endif
     
-    /* Increment buffer count for tracking (optional, for debugging/stats) */
-    if (buffer_count < 255)
+#if TX_CREDIT_ENABLE
+    /* --- Credit request: reply with the free FIFO space --- */
+    if (rx_char == CTRL_CREDIT)
     {
-        buffer_count += 2;  /* Two nibbles processed */
+        credit_enabled = 1;
+        credit_tail = rx_fifo_tail;     /* Everything before is accounted */
+        uart_putc(CTRL_CREDIT);
+        uart_putc((RX_FIFO_SIZE - 1) - RX_FIFO_COUNT());
+        return;
+    }
+#endif
+    
+    /* --- Process data character --- */
+    encode_char(rx_char);
+    
+#if TX_RESYNC_ENABLE && TX_RESYNC_INTERVAL
+    resync_check();
+#endif
+}
+
+#if TX_CREDIT_ENABLE
+/* credit_report
+ * Number of bytes consumed since the last report is the distance the FIFO
+ * read index moved. It stays below RX_FIFO_SIZE because the host has at
+ * most RX_FIFO_SIZE - 1 bytes in flight.
+ *
+ * 1. Report once TX_CREDIT_BATCH bytes are consumed (bounds uplink traffic)
+ * 2. Report any remainder when the FIFO is empty (host may be waiting)
+ */
+void credit_report(void)
+{
+    uint8_t consumed;
+    uint8_t tail;
+    
+    if (!credit_enabled)
+    {
+        return;
+    }
+    
+    tail = rx_fifo_tail;
+    consumed = (tail - credit_tail) & RX_FIFO_MASK;
+    
+    if (consumed >= TX_CREDIT_BATCH ||
+        (consumed != 0 && tail == rx_fifo_head))
+    {
+        uart_putc(CTRL_CREDIT);
+        uart_putc(consumed);
+        credit_tail = tail;
     }
 }
+#endif
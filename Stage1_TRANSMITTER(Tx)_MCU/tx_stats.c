@@ -0,0 +1,215 @@
+/* File: tx_stats.c
+ * Hot-path timing statistics for the Tx MCU (TX_INSTRUMENT) and the
+ * CTRL_TOGGLES dump of the switching-activity counters (TX_TOGGLE_STATS)
+ *
+ * Timer 0 runs free as a 16-bit timer without interrupt. A stage is timed
+ * as stamp_now() at its start and stat_record() at its end. One Timer 0
+ * period is 65536 core cycles (~5.93 ms), and unsigned 16-bit subtraction
+ * gives the elapsed count across one overflow, not more: a sample longer
+ * than ~5.9 ms (a STAT_HANDOFF or STAT_WAKE behind a long burst or resync)
+ * wraps silently and is recorded modulo 65536 counts.
+ *
+ * All functions here run in main-loop context. UART_ISR only writes
+ * rx_stamp/rx_stamp_valid, using STAMP_READ.
+ */
+
+#include <aduc841.h>
+#include "header.h"
+
+#if TX_INSTRUMENT
+
+stage_stat_t idata tx_stats[STAT_COUNT];
+uint16_t stat_overhead = 0;
+volatile uint16_t irq_latency_max = 0;
+
+volatile uint16_t rx_stamp = 0;
+volatile bit rx_stamp_valid = 0;
+
+/* stats_clear
+ * Reset all stages: min starts at the largest value so the first sample
+ * always replaces it.
+ */
+static void stats_clear(void)
+{
+    uint8_t i;
+    
+    for (i = 0; i < STAT_COUNT; i++)
+    {
+        tx_stats[i].count = 0;
+        tx_stats[i].min = 0xFFFF;
+        tx_stats[i].max = 0;
+        tx_stats[i].sum = 0;
+    }
+}
+
+/* stats_init
+ * 1. Timer 0 in mode 1 (16-bit), no interrupt (Timer 1 bits unchanged)
+ * 2. Clear the statistics
+ * 3. Measure the cost of an empty stage: stamp_now() directly followed by
+ *    the read in stat_record(). This is subtracted from every sample.
+ */
+void stats_init(void)
+{
+    uint16_t start;
+    
+    TMOD &= 0xF0;
+    TMOD |= 0x01;   /* Mode 1: 16-bit timer */
+    TH0 = 0;
+    TL0 = 0;
+    ET0 = 0;        /* Free-running, polled only */
+    TR0 = 1;
+    
+    stats_clear();
+    
+    stat_overhead = 0;
+    start = stamp_now();
+    stat_overhead = stamp_now() - start;
+}
+
+/* stamp_now
+ * Current Timer 0 count (main loop only; UART_ISR uses STAMP_READ).
+ */
+uint16_t stamp_now(void)
+{
+    uint16_t value;
+    
+    STAMP_READ(value);
+    
+    return value;
+}
+
+/* stat_record
+ * Add one sample for stage: elapsed counts since start, minus the
+ * timestamp overhead.
+ */
+void stat_record(uint8_t stage, uint16_t start)
+{
+    uint16_t elapsed;
+    stage_stat_t idata *st;
+    
+    elapsed = stamp_now() - start;
+    elapsed = (elapsed > stat_overhead) ? (elapsed - stat_overhead) : 0;
+    
+    st = &tx_stats[stage];
+    
+    if (st->count == 0xFFFF)
+    {
+        return;     /* Saturated: keep avg = sum / count consistent */
+    }
+    
+    st->count++;
+    st->sum += elapsed;
+    
+    if (elapsed < st->min)
+    {
+        st->min = elapsed;
+    }
+    if (elapsed > st->max)
+    {
+        st->max = elapsed;
+    }
+}
+
+/* stat_handoff_take
+ * Called by RX_FIFO_POP before the byte is taken. While the FIFO is not
+ * empty UART_ISR does not write rx_stamp, so it is stable here.
+ */
+void stat_handoff_take(void)
+{
+    if (rx_stamp_valid)
+    {
+        rx_stamp_valid = 0;
+        stat_record(STAT_HANDOFF, rx_stamp);
+    }
+}
+
+#endif
+
+#if TX_INSTRUMENT || TX_TOGGLE_STATS
+/* send_u16 / send_u32: MSB first */
+static void send_u16(uint16_t value)
+{
+    uart_putc((uint8_t)(value >> 8));
+    uart_putc((uint8_t)value);
+}
+
+static void send_u32(unsigned long value)
+{
+    send_u16((uint16_t)(value >> 16));
+    send_u16((uint16_t)value);
+}
+
+#endif
+
+#if TX_INSTRUMENT
+/* stats_dump
+ * Reply to CTRL_STATS, <clear> (format in header.h).
+ */
+void stats_dump(uint8_t clear)
+{
+    uint8_t i;
+    uint16_t latency;
+    
+    /* Timer1_ISR may update it between the two byte reads */
+    do
+    {
+        latency = irq_latency_max;
+    } while (latency != irq_latency_max);
+    
+    uart_putc(CTRL_STATS);
+    uart_putc(STATS_PAYLOAD_LEN);
+    
+    send_u16(stat_overhead);
+    uart_putc(rx_overrun_count);
+    uart_putc(rx_fifo_peak);
+    send_u16(latency);
+    
+    for (i = 0; i < STAT_COUNT; i++)
+    {
+        send_u16(tx_stats[i].count);
+        send_u16(tx_stats[i].min);
+        send_u16(tx_stats[i].max);
+        send_u32(tx_stats[i].sum);
+    }
+    
+    if (clear)
+    {
+        stats_clear();
+        ET1 = 0;                /* Two-byte store: keep Timer1_ISR out */
+        irq_latency_max = 0;
+        ET1 = 1;
+    }
+}
+
+#endif
+
+#if TX_TOGGLE_STATS
+/* toggles_dump
+ * Reply to CTRL_TOGGLES, <clear> (format in header.h).
+ */
+void toggles_dump(uint8_t clear)
+{
+    uint8_t i;
+    
+    uart_putc(CTRL_TOGGLES);
+    uart_putc(TOGGLES_PAYLOAD_LEN);
+    
+    send_u32(toggle_symbols);
+    send_u32(toggle_total);
+    
+    for (i = 0; i < HAMMING_N; i++)
+    {
+        send_u16(toggle_line[i]);
+    }
+    
+    if (clear)
+    {
+        toggle_symbols = 0;
+        toggle_total = 0;
+        for (i = 0; i < HAMMING_N; i++)
+        {
+            toggle_line[i] = 0;
+        }
+    }
+}
+#endif
@@ -1,40 +1,192 @@
 /* File: rx_decoder.c
- * Uses PROVIDED decoding logic
+ * Decodes the bus state X to the syndrome S = H * X^T.
+ *
+ * Packed path (used by main): the raw port word from read_bus_raw() is
+ * reordered into a line word (bit i = line i+1) and reduced to S with one
+ * masked parity per syndrome bit (SYNDROME_KERNEL in header.h), the same
+ * kernel as the Tx compute_syndrome_from_bus(). No X[] or S[] arrays and
+ * no stored matrix are needed.
+ *
+ * Array path: get_S_from_X() packs X[] and calls the packed decoder; it is
+ * kept for callers that still work on one byte per line.
+ *
+ * Because S is the syndrome of the WHOLE bus state, the decode stays right
+ * however many lines are high; the bus never needs a reset to be readable.
  */
 #include <aduc841.h>
-#include <string.h>
 #include "header.h"
 
+// Port order -> line order (RAW_BUS_MASK layout in header.h)
+uint16_t bus_lines_from_raw(uint16_t raw)
+{
+#if (HAMMING_R == 4)
+    return (raw & 0x00FF)               // P2.0-P2.7 -> lines 1-8
+         | ((raw >> 4) & 0x0F00)        // P3.4-P3.7 -> lines 9-12
+         | ((raw << 4) & 0x7000);       // P0.0-P0.2 -> lines 13-15
+#else
+    return raw & BUS_LINE_MASK;         // P2 is already in line order
+#endif
+}
+
+#if (SYNDROME_KERNEL == SYNDROME_KERNEL_PARITY) || RX_AUX_PARITY
+// Byte parity; on C51 loading ACC sets the PSW parity flag P
+static uint8_t parity8(uint8_t value)
+{
+#ifdef __C51__
+    ACC = value;
+    return P;
+#else
+    value ^= value >> 4;
+    value ^= value >> 2;
+    value ^= value >> 1;
+    return value & 0x01;
+#endif
+}
+#endif
+
+#if RX_AUX_PARITY
+// Lines plus aux line (RAW_BUS_MASK) must hold an even number of ones
+bit aux_parity_ok(uint16_t raw)
+{
+    raw &= RAW_BUS_MASK;
+    
+    return !parity8((uint8_t)(raw ^ (raw >> 8)));
+}
+#endif
+
+#if (SYNDROME_KERNEL == SYNDROME_KERNEL_PARITY)
+// Parity of a line word: fold the high byte into the low one first
+static uint8_t parity_lines(uint16_t value)
+{
+#if (HAMMING_R == 4)
+    return parity8((uint8_t)(value ^ (value >> 8)));
+#else
+    return parity8((uint8_t)value);
+#endif
+}
+
+// S bit k = parity of the lines whose column index has bit k set
+// (H1_COL_MASKk in header.h); equal to the XOR of column indices
+uint8_t get_S_from_lines(uint16_t lines)
+{
+    uint8_t syndrome;
+    
+    syndrome  = parity_lines(lines & H1_COL_MASK0);
+    syndrome |= parity_lines(lines & H1_COL_MASK1) << 1;
+#if (HAMMING_R >= 3)
+    syndrome |= parity_lines(lines & H1_COL_MASK2) << 2;
+#endif
+#if (HAMMING_R >= 4)
+    syndrome |= parity_lines(lines & H1_COL_MASK3) << 3;
+#endif
+    
+    return syndrome;
+}
+
+#else
+// S = XOR of column indices (i+1) of all set lines i
+uint8_t get_S_from_lines(uint16_t lines)
+{
+    uint8_t syndrome = 0;
+    uint8_t col_idx;
+    
+    for (col_idx = 1; col_idx <= HAMMING_N; col_idx++)
+    {
+        if (lines & 0x0001)
+        {
+            syndrome ^= col_idx;
+        }
+        lines >>= 1;
+    }
+    
+    return syndrome;
+}
+#endif
+
+uint8_t get_S_from_raw(uint16_t raw)
+{
+    return get_S_from_lines(bus_lines_from_raw(raw));
+}
+
+/* Stateful decoder: previous sample, to report which line toggled.
+ * The Tx changes one line per nonzero symbol, w = column (S_old ^ S_new),
+ * so for a single-line change the toggled column is just the XOR of the
+ * two syndromes; no bit scan of the difference is needed. */
+static uint16_t rx_last_lines = 0;
+static uint8_t rx_last_syndrome = 0;
+uint8_t rx_toggled_line = 0;
+
+// Take raw as the new reference state (power-up, resync)
+void rx_decode_reset(uint16_t raw)
+{
+    rx_last_lines = bus_lines_from_raw(raw);
+    rx_last_syndrome = get_S_from_lines(rx_last_lines);
+    rx_toggled_line = 0;
+}
+
+uint8_t rx_decode_step(uint16_t raw)
+{
+    uint16_t lines;
+    uint16_t diff;
+    uint8_t syndrome;
+    
+    lines = bus_lines_from_raw(raw);
+    syndrome = get_S_from_lines(lines);
+    diff = lines ^ rx_last_lines;
+    
+    if (diff == 0)
+    {
+        rx_toggled_line = 0;                            // Repeated symbol
+    }
+    else if ((diff & (diff - 1)) == 0)
+    {
+        rx_toggled_line = syndrome ^ rx_last_syndrome;  // Single line
+    }
+#if RX_RESYNC_ENABLE
+    else if (lines == 0)
+    {
+        rx_toggled_line = RX_TOGGLE_RESYNC;             // Tx back at zero
+    }
+    else if (syndrome == rx_last_syndrome)
+    {
+        rx_toggled_line = RX_TOGGLE_SKIP;               // Resync preparation
+    }
+#endif
+    else
+    {
+        rx_toggled_line = RX_TOGGLE_MULTI;              // Missed samples
+    }
+    
+    rx_last_lines = lines;
+    rx_last_syndrome = syndrome;
+    
+    return syndrome;
+}
+
+// Compatibility wrapper: X[] (one byte per line) -> S[] (MSB first)
 void get_S_from_X(const uint8_t *X_vector, uint8_t hamming_R, uint8_t *S_output)
 {
     /* Renamed variable to avoid conflict with #define HAMMING_N in header.h */
     uint8_t hamming_n_limit; 
     uint8_t i;
-    uint8_t position_val = 0;
+    uint16_t lines = 0;
+    uint8_t syndrome;
     
     /* Calculate N based on R input (2^R - 1) */
     hamming_n_limit = (1 << hamming_R) - 1;
     
-    /* Find position of '1' bit */
-    for (i = 0; i < hamming_n_limit; i++)
+    /* Pack X into a line word, line 1 in bit 0 */
+    for (i = hamming_n_limit; i > 0; i--)
     {
-        if (X_vector[i] != 0)
-        {
-            position_val = i + 1;
-            break;
-        }
+        lines = (lines << 1) | (X_vector[i - 1] != 0);
     }
     
-    /* Reset output */
-    memset(S_output, 0, hamming_R);
+    syndrome = get_S_from_lines(lines);
     
-    /* Convert position to binary array (MSB first) */
-    if (position_val > 0)
+    /* Convert syndrome to binary array (MSB first) */
+    for (i = 0; i < hamming_R; i++)
     {
-        for (i = 0; i < hamming_R; i++)
-        {
-            S_output[i] = (uint8_t)((position_val >> (hamming_R - 1 - i)) & 0x01);
-        }
+        S_output[i] = (uint8_t)((syndrome >> (hamming_R - 1 - i)) & 0x01);
     }
 }
 
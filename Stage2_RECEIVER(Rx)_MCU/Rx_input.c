@@ -1,23 +1,148 @@
 /* File: rx_input.c
- * Reads 12-bit X from Port 2 (P2.0-P2.7) and Port 3 (P3.4-P3.7)
+ * Reads N-bit X from the input ports. Line map (X index = column - 1):
+ *   R = 2: X[0-2]  = P2.0-P2.2
+ *   R = 3: X[0-6]  = P2.0-P2.6
+ *   R = 4: X[0-7]  = P2.0-P2.7
+ *          X[8-11] = P3.4-P3.7
+ *          X[12-14] = P0.0-P0.2 (P0 is open-drain: needs external pull-ups)
+ * Lane B (RX_LANES == 2), line order: P1.0-P1.7, P0.3-P0.7, P3.2-P3.3
+ * Aux parity line (RX_AUX_PARITY): P3.3 for R = 4, P2.N for R < 4
+ * read_bus_raw() takes one stable snapshot of the ports (RAW_BUS_MASK
+ * layout in header.h, RX_STABLE_READS) so a capture loop can compare
+ * states without unpacking them.
  */
 #include <aduc841.h>
 #include <string.h>
 #include "header.h"
 
-void read_X_from_bus(uint8_t *X)
+#if (HAMMING_R == 4)
+#define RX_P3_MASK      (0xF0 | (RX_AUX_RAW_BIT >> 8))   // Lines 9-12 (+ aux)
+
+// One pass over the ports of each lane (RAW_BUS_MASK layout / line order)
+#define READ_LANE_A()   (P2 | ((uint16_t)(P0 & 0x07) << 8) | ((uint16_t)(P3 & RX_P3_MASK) << 8))
+#define READ_LANE_B()   (P1 | ((uint16_t)(P0 & 0xF8) << 5) | ((uint16_t)(P3 & 0x0C) << 11))
+#endif
+
+#if (HAMMING_R == 4)
+#define READ_BUS()      READ_LANE_A()
+#else
+#define READ_BUS()      (P2 & RAW_BUS_MASK)     // All N <= 7 lines fit on P2
+#endif
+
+#if (RX_LANES == 2)
+uint16_t rx_raw_b = 0;
+#endif
+
+#if RX_READ_CHECKED
+bit rx_read_error = 0;
+#endif
+
+// One stable snapshot (RX_STABLE_READS); read_bus_raw() adds the parity
+// check with RX_AUX_PARITY
+#if RX_AUX_PARITY
+static uint16_t read_bus_snapshot(void)
+#else
+uint16_t read_bus_raw(void)
+#endif
+{
+    uint16_t raw;
+    uint16_t next;
+    uint8_t stable = 1;
+#if RX_STABLE_WINDOW
+    uint8_t reads = 1;
+#endif
+#if (RX_LANES == 2)
+    uint16_t raw_b;
+    uint16_t next_b;
+#endif
+    
+    // Interrupts stay on. An ISR or a Tx latch between the port reads
+    // could mix two bus states, and lines may still settle after the RCLK
+    // edge, so read back-to-back until RX_STABLE_READS reads in a row
+    // agree. With two lanes both are in every read: a latch anywhere in
+    // between makes one of the two lane words differ.
+    raw = READ_BUS();
+#if (RX_LANES == 2)
+    raw_b = READ_LANE_B();
+#endif
+#if RX_READ_CHECKED
+    rx_read_error = 0;
+#endif
+    
+    while (stable < RX_STABLE_READS)
+    {
+        next = READ_BUS();
+#if (RX_LANES == 2)
+        next_b = READ_LANE_B();
+        if (next == raw && next_b == raw_b)
+#else
+        if (next == raw)
+#endif
+        {
+            stable++;
+        }
+        else
+        {
+            raw = next;             // Changed: start counting again
+#if (RX_LANES == 2)
+            raw_b = next_b;
+#endif
+            stable = 1;
+        }
+        
+#if RX_STABLE_WINDOW
+        // Window used up without a stable value: reject the sample
+        if (++reads >= RX_STABLE_WINDOW && stable < RX_STABLE_READS)
+        {
+            rx_read_error = 1;
+            break;
+        }
+#endif
+    }
+    
+#if (RX_LANES == 2)
+    rx_raw_b = raw_b;
+#endif
+    
+    return raw;
+}
+
+#if RX_AUX_PARITY
+uint16_t read_bus_raw(void)
+{
+    uint16_t raw;
+    uint8_t tries = RX_AUX_RETRIES;
+    
+    // An odd (or unstable) snapshot has a wrong line: read until it clears
+    do
+    {
+        raw = read_bus_snapshot();
+        if (!aux_parity_ok(raw))
+        {
+            rx_read_error = 1;
+        }
+    } while (rx_read_error && tries-- != 0);
+    
+    return raw;
+}
+#endif
+
+void unpack_X_from_raw(uint16_t raw, uint8_t *X)
 {
-    uint8_t p2_val, p3_val;
+    uint8_t p2_val;
+#if (HAMMING_R == 4)
+    uint8_t p3_val, p0_val;
+#endif
     uint8_t i;
     
     // Clear output
     memset(X, 0, HAMMING_N);
     
-    // Read ports atomically
-    EA = 0;
-    p2_val = P2;
-    p3_val = P3;
-    EA = 1;
+    p2_val = (uint8_t)raw;
+    
+#if (HAMMING_R == 4)
+    p0_val = (uint8_t)(raw >> 8) & 0x07;
+    p3_val = (uint8_t)(raw >> 8) & 0xF0;
     
     // Unpack P2 into X[0-7]
     for (i = 0; i < 8; i++)
@@ -30,4 +155,21 @@ void read_X_from_bus(uint8_t *X)
     {
         X[8 + i] = (p3_val >> (4 + i)) & 0x01;
     }
+    
+    // Unpack P0.0-P0.2 into X[12-14]
+    for (i = 0; i < 3; i++)
+    {
+        X[12 + i] = (p0_val >> i) & 0x01;
+    }
+#else
+    for (i = 0; i < HAMMING_N; i++)
+    {
+        X[i] = (p2_val >> i) & 0x01;
+    }
+#endif
+}
+
+void read_X_from_bus(uint8_t *X)
+{
+    unpack_X_from_raw(read_bus_raw(), X);
 }
@@ -1,10 +1,37 @@
 /* File: rx_output.c
- * Transmits decimal value as ASCII string via UART
+ * Transmits decimal value as ASCII string via UART, or packed binary
+ * frames (RX_OUTPUT_BINARY)
+ * Bytes go into txq and are sent by the serial ISR, so the caller does not
+ * wait for the wire (about 1 ms per byte at 9600 baud).
  */
 #include <aduc841.h>
 #include "header.h"
 
-void transmit_decimal_uart(uint8_t value)
+volatile uint8_t idata txq[TXQ_SIZE];
+volatile uint8_t txq_head = 0;
+volatile uint8_t txq_tail = 0;
+volatile bit txq_idle = 1;
+
+// Enqueue one byte for the serial ISR. Waits only if the queue is full.
+static void uart_send(uint8_t c)
+{
+    uint8_t next_head;
+    
+    next_head = (txq_head + 1) & TXQ_MASK;
+    while (next_head == txq_tail);  // Full: ISR frees a slot per byte sent
+    
+    txq[txq_head] = c;
+    txq_head = next_head;           // Publish to the ISR
+    
+    // ISR went idle before seeing this byte: raise TI to restart it
+    if (txq_idle)
+    {
+        txq_idle = 0;
+        TI = 1;
+    }
+}
+
+static void transmit_digits(uint8_t value)
 {
     uint8_t digits[3];  // Max 2 digits + null
     uint8_t i = 0;
@@ -27,17 +54,196 @@ void transmit_decimal_uart(uint8_t value)
     // Transmit in correct order (reverse)
     for (j = i; j > 0; j--)
     {
-        while (!TI);
-        TI = 0;
-        SBUF = digits[j - 1];
+        uart_send(digits[j - 1]);
     }
+}
+
+void transmit_decimal_uart(uint8_t value)
+{
+    transmit_digits(value);
     
     // Transmit newline
-    while (!TI);
-    TI = 0;
-    SBUF = '\r';
+    uart_send('\r');
+    uart_send('\n');
+}
+
+// "<value> <line>\r\n": line = column that toggled since the last sample,
+// 0 = none, '*' = more than one line changed (RX_TOGGLE_MULTI)
+void transmit_decimal_toggle_uart(uint8_t value, uint8_t line)
+{
+    transmit_digits(value);
+    uart_send(' ');
+    
+    if (line == RX_TOGGLE_MULTI)
+    {
+        uart_send('*');
+    }
+    else
+    {
+        transmit_digits(line);
+    }
+    
+    uart_send('\r');
+    uart_send('\n');
+}
+
+#if RX_RESYNC_ENABLE
+// "R\r\n": Tx resync, the host drops an unfinished character
+void transmit_resync_uart(void)
+{
+    uart_send('R');
+    uart_send('\r');
+    uart_send('\n');
+}
+#endif
+
+#if RX_READ_CHECKED
+// "E\r\n": sample dropped (unstable, or lines + aux line stayed odd)
+void transmit_read_error_uart(void)
+{
+    uart_send('E');
+    uart_send('\r');
+    uart_send('\n');
+}
+#endif
+
+#if RX_WAKE_STATS || RX_LATENCY_STATS
+// Decimal digits of a 16-bit value, no newline
+static void transmit_u16(uint16_t value)
+{
+    uint8_t digits[5];
+    uint8_t i = 0;
+    
+    do
+    {
+        digits[i++] = '0' + (uint8_t)(value % 10);
+        value /= 10;
+    } while (value > 0);
     
-    while (!TI);
-    TI = 0;
-    SBUF = '\n';
+    while (i > 0)
+    {
+        uart_send(digits[--i]);
+    }
+}
+#endif
+
+#if RX_WAKE_STATS
+// "W <max> <avg>\r\n": wake latency in Timer1 counts
+void transmit_wake_report(uint16_t max, uint16_t avg)
+{
+    uart_send('W');
+    uart_send(' ');
+    transmit_u16(max);
+    uart_send(' ');
+    transmit_u16(avg);
+    uart_send('\r');
+    uart_send('\n');
+}
+#endif
+
+#if RX_LATENCY_STATS
+// "L <max>\r\n": worst interrupt latency in Timer2 counts
+void transmit_latency_report(uint16_t max)
+{
+    uart_send('L');
+    uart_send(' ');
+    transmit_u16(max);
+    uart_send('\r');
+    uart_send('\n');
+}
+#endif
+
+#if (RX_OUTPUT_FORMAT == RX_OUTPUT_BINARY)
+static uint8_t idata frame_buf[RX_FRAME_MAX];
+static uint8_t frame_len = 0;
+static uint16_t sym_acc = 0;    // Symbol bits not yet forming a full byte
+static uint8_t sym_bits = 0;
+
+#if RX_FRAME_CRC
+// CRC-8, poly x^8 + x^2 + x + 1 (0x07), MSB-first
+static uint8_t crc8_update(uint8_t crc, uint8_t b)
+{
+    uint8_t i;
+    
+    crc ^= b;
+    for (i = 0; i < 8; i++)
+    {
+        if (crc & 0x80)
+        {
+            crc = (crc << 1) ^ 0x07;
+        }
+        else
+        {
+            crc <<= 1;
+        }
+    }
+    
+    return crc;
+}
+#endif
+
+// Send the pending bytes as one frame; nothing if the frame is empty
+void transmit_binary_flush(void)
+{
+    uint8_t i;
+#if RX_FRAME_CRC
+    uint8_t crc;
+#endif
+    
+    if (frame_len == 0)
+    {
+        return;
+    }
+    
+    uart_send(RX_FRAME_SYNC);
+    uart_send(frame_len);
+#if RX_FRAME_CRC
+    crc = crc8_update(0x00, frame_len);
+#endif
+    
+    for (i = 0; i < frame_len; i++)
+    {
+        uart_send(frame_buf[i]);
+#if RX_FRAME_CRC
+        crc = crc8_update(crc, frame_buf[i]);
+#endif
+    }
+    
+#if RX_FRAME_CRC
+    uart_send(crc);
+#endif
+    
+    frame_len = 0;
+}
+
+// Append one decoded symbol. Mirrors the Tx split: R-bit symbols MSB-first,
+// so every 8 collected bits are one original character.
+void transmit_binary_symbol(uint8_t symbol)
+{
+    sym_acc = (sym_acc << HAMMING_R) | (symbol & HAMMING_N);
+    sym_bits += HAMMING_R;
+    
+    if (sym_bits >= 8)
+    {
+        sym_bits -= 8;
+        frame_buf[frame_len++] = (uint8_t)(sym_acc >> sym_bits);
+        sym_acc &= ((uint16_t)1 << sym_bits) - 1;
+        
+        if (frame_len == RX_FRAME_MAX)
+        {
+            transmit_binary_flush();
+        }
+    }
+}
+
+#if RX_RESYNC_ENABLE
+// Tx resync: send the complete characters, drop the bits of an
+// unfinished one (R = 3: zero padding of the last carried bits)
+void transmit_binary_resync(void)
+{
+    transmit_binary_flush();
+    sym_acc = 0;
+    sym_bits = 0;
 }
+#endif
+#endif
@@ -3,20 +3,360 @@
 #define HEADER_H
 
 typedef unsigned char uint8_t;
+typedef unsigned int  uint16_t;
 
+/* H1 bus parameters - HAMMING_R must match the Tx header.h.
+ * N = 2^R - 1 bus lines are read from the ports (map in rx_input.c).
+ * R = 5 (31 lines) is not supported: beside the UART pins (P3.0/P3.1)
+ * the ADuC841 has only 30 port pins left to read the bus from. */
 #define HAMMING_R 4
-#define HAMMING_N 15
+#define HAMMING_N ((1 << HAMMING_R) - 1)
+#define BUS_LINE_MASK ((1U << HAMMING_N) - 1)   // Line word, bit i = line i+1
+
+#if (HAMMING_R < 2) || (HAMMING_R > 4)
+#error "Receiver supports HAMMING_R = 2, 3 or 4"
+#endif
+
+/* Syndrome kernel (User-Editable), same options as the Tx header.h.
+ * SYNDROME_KERNEL_LOOP:   XOR of the column indices of all set lines.
+ * SYNDROME_KERNEL_PARITY: syndrome bit k = parity(lines & H1_COL_MASKk);
+ *                         R branch-free masked parities, constant time.
+ * Masks: the columns whose index has bit k set, cut to N lines
+ * (R = 4: 0x5555, 0x6666, 0x7878, 0x7F80). */
+#define SYNDROME_KERNEL_LOOP    0
+#define SYNDROME_KERNEL_PARITY  1
+#define SYNDROME_KERNEL         SYNDROME_KERNEL_PARITY
+
+#define H1_COL_MASK0    (0x5555 & BUS_LINE_MASK)
+#define H1_COL_MASK1    (0x6666 & BUS_LINE_MASK)
+#define H1_COL_MASK2    (0x7878 & BUS_LINE_MASK)
+#define H1_COL_MASK3    (0x7F80 & BUS_LINE_MASK)
+
+/* Core clock (User-Editable), same as CORE_CLK_HZ in the Tx header.h.
+ * The ADuC841 core is single-cycle and Timers 0, 1 and 2 count core
+ * cycles: ~90.4 ns per count at 11.0592 MHz, 65536 counts (~5.93 ms) per
+ * 16-bit wrap. RX_US_TICKS(us) converts microseconds to timer counts. */
+#define CORE_CLK_HZ     11059200UL
+#define RX_US_TICKS(us) (((us) * (CORE_CLK_HZ / 1000UL) + 500UL) / 1000UL)
+
+/* UART baud rate table index (same table as the Tx header.h).
+ * The receiver only transmits (REN = 0), so the rate is fixed at compile
+ * time instead of negotiated; pick the entry the host reader is set to. */
+#define BAUD_9600       0
+#define BAUD_19200      1
+#define BAUD_38400      2
+#define BAUD_57600      3
+#define BAUD_115200     4
+#define BAUD_230400     5
+#define BAUD_COUNT      6
+
+#define UART_BAUD_INDEX BAUD_9600
+
+/* Bus capture mode (User-Editable)
+ * RX_CAPTURE_TIMER:  Decode on every Timer0 tick (~0.9 ms), repeats included.
+ * RX_CAPTURE_POLL:   Main loop reads the ports back-to-back and decodes each
+ *                    new bus state exactly once. A repeated symbol (w = 0) does
+ *                    not change the bus and is therefore not seen.
+ * RX_CAPTURE_STROBE: Tx STROBE_PIN (P2.3, TX_SYMBOL_STROBE) wired to INT0
+ *                    (P3.2); each falling edge triggers one decode, so a
+ *                    repeated symbol is reported again. Tx RCLK_PIN works too
+ *                    without TX_SKIP_UNCHANGED, but then repeats are missed.
+ * RX_CAPTURE_PLL:    No strobe wire. The main loop polls for transitions and
+ *                    timestamps them with Timer1; the shortest gap among
+ *                    RX_PLL_WINDOW transitions is the Tx symbol period T (a
+ *                    fixed T needs Tx TX_PIPELINE). Each transition re-phases
+ *                    Timer0 to sample T/2 later and then every T, so repeats
+ *                    are counted. Until the first period estimate, each
+ *                    transition is decoded as in POLL mode.
+ */
+#define RX_CAPTURE_TIMER    0
+#define RX_CAPTURE_POLL     1
+#define RX_CAPTURE_STROBE   2
+#define RX_CAPTURE_PLL      3
+#define RX_CAPTURE_MODE     RX_CAPTURE_TIMER
+
+/* Phase lock settings (RX_CAPTURE_PLL)
+ * The PLL locks to a symbol period T (Tx 1 / TX_PIPE_RATE_HZ) from
+ * RX_PLL_MIN_US to RX_PLL_MAX_US. The Tx default of 4000 symbols/s is
+ * 250 us; a rate matched to 9600 baud (two R = 4 symbols per byte) is
+ * ~520 us. Before the first estimate a gap longer than RX_PLL_MAX_US is
+ * not measured at all, so a slower Tx never locks and stays in POLL mode.
+ * RX_PLL_HOLD: samples taken after the last transition before the sampler
+ * stops. The Tx idle and a run of repeated symbols look the same on the
+ * bus, so a run longer than RX_PLL_HOLD symbols is cut short. Gaps longer
+ * than RX_PLL_HOLD + 1 periods are not used for the estimate; Timer1
+ * stamps wrap after 65536 counts (~5.93 ms), so (RX_PLL_HOLD + 1) periods
+ * of RX_PLL_MAX_US must fit in that. */
+#define RX_PLL_WINDOW       8       // Transitions per period estimate
+#define RX_PLL_HOLD         8       // Samples without a transition
+#define RX_PLL_MIN_US       50      // Shortest plausible period
+#define RX_PLL_MAX_US       600     // Longest period that can lock
+#define RX_PLL_MIN_TICKS    RX_US_TICKS(RX_PLL_MIN_US)     // 553 counts
+#define RX_PLL_MAX_TICKS    RX_US_TICKS(RX_PLL_MAX_US)     // 6636 counts
+
+#if (RX_PLL_HOLD < 1) || (RX_PLL_HOLD > 255)
+#error "RX_PLL_HOLD must be 1..255"
+#endif
+
+#if (RX_PLL_MIN_TICKS < 1) || (RX_PLL_MIN_US >= RX_PLL_MAX_US) || \
+    ((RX_PLL_HOLD + 1) * RX_PLL_MAX_TICKS > 65535UL)
+#error "RX_PLL_MIN_US..RX_PLL_MAX_US: need MIN < MAX and (RX_PLL_HOLD + 1) * RX_PLL_MAX_US <= 5925 us"
+#endif
+
+/* Aux parity line (User-Editable), matches Tx TX_AUX_PARITY.
+ * The Tx drives the parity of the N lines on one more output, so lines
+ * plus aux line always hold an even number of ones. Wiring:
+ *   R = 4: P3.3 (raw bit 11)
+ *   R < 4: P2.N (raw bit N)
+ * read_bus_raw() reads an odd snapshot again, up to RX_AUX_RETRIES more
+ * times: a glitch on one line is usually gone by then. If it stays odd,
+ * rx_read_error is set and main drops the sample ("E\r\n" in ASCII)
+ * instead of forwarding a wrong symbol; POLL and PLL capture do not take
+ * it as a transition. One parity line finds a single wrong line but
+ * cannot name it (every odd pattern has two one-line explanations, e.g.
+ * a repeat plus a glitch on line j, or a toggle of j plus a glitch on the
+ * aux line), so reading again is the correction. */
+#define RX_AUX_PARITY   0
+#define RX_AUX_RETRIES  4
+
+#if RX_AUX_PARITY && (HAMMING_R == 4)
+#define RX_AUX_RAW_BIT  0x0800
+#elif RX_AUX_PARITY
+#define RX_AUX_RAW_BIT  (1U << HAMMING_N)
+#else
+#define RX_AUX_RAW_BIT  0
+#endif
+
+#if (RX_AUX_RETRIES > 255)
+#error "RX_AUX_RETRIES must be 0..255"
+#endif
+
+/* Stable-read filter (User-Editable)
+ * read_bus_raw() reads the ports back-to-back and accepts a value only
+ * once RX_STABLE_READS reads in a row agree (all lanes in every read). A
+ * read that overlaps the Tx RCLK edge, or lines still settling after it,
+ * then never yields a mix of two bus states, and the Tx symbol period
+ * does not need a margin for it. 2 is a plain double snapshot; raise it
+ * for slow edges (long traces, P0 pull-ups) to run the bus faster.
+ * RX_STABLE_WINDOW: most reads per sample, 0 = read until stable. When
+ * no value is stable within the window, rx_read_error is set and main
+ * drops the sample as for an aux parity error. */
+#define RX_STABLE_READS     2
+#define RX_STABLE_WINDOW    0
+
+#if (RX_STABLE_READS < 1) || (RX_STABLE_READS > 255)
+#error "RX_STABLE_READS must be 1..255"
+#endif
+
+#if (RX_STABLE_WINDOW != 0) && ((RX_STABLE_WINDOW < RX_STABLE_READS) || (RX_STABLE_WINDOW > 255))
+#error "RX_STABLE_WINDOW must be 0 or RX_STABLE_READS..255"
+#endif
+
+// read_bus_raw() can reject a sample (rx_read_error)
+#define RX_READ_CHECKED     (RX_AUX_PARITY || RX_STABLE_WINDOW)
+
+/* Raw bus snapshot from read_bus_raw(): port bits, not yet in line order.
+ *   R = 4: bits 0-7   = P2.0-P2.7 (lines 1-8)
+ *          bits 8-10  = P0.0-P0.2 (lines 13-15)
+ *          bit 11     = P3.3 (aux line, RX_AUX_PARITY)
+ *          bits 12-15 = P3.4-P3.7 (lines 9-12)
+ *   R < 4: bits 0..N-1 = P2.0.. (lines 1..N), bit N = aux line
+ * Two snapshots are equal exactly when the bus state is equal. */
+#if (HAMMING_R == 4)
+#define RAW_BUS_MASK  (0xF7FF | RX_AUX_RAW_BIT)
+#else
+#define RAW_BUS_MASK  (BUS_LINE_MASK | RX_AUX_RAW_BIT)
+#endif
+
+/* Two-lane bus (User-Editable), matches Tx TX_LANES.
+ * RX_LANES = 2 reads a second 15-line bus (lane B) on the pins left over:
+ *   lines 1-8   = P1.0-P1.7 (digital inputs)
+ *   lines 9-13  = P0.3-P0.7 (open-drain: needs external pull-ups)
+ *   lines 14-15 = P3.2-P3.3
+ * read_bus_raw() takes both lanes in the same snapshot and leaves lane B
+ * in rx_raw_b, already in line order (bit i = line i+1). Every sample is
+ * then two symbols: lane A (high nibble) first, then lane B (low nibble),
+ * so the output stream is the same as with one lane.
+ * Needs HAMMING_R = 4. P3.2 is INT0, so RX_CAPTURE_STROBE is not
+ * available, and RX_REPORT_TOGGLES (one line per record) is not either. */
+#define RX_LANES    1
+
+#if (RX_LANES != 1) && (RX_LANES != 2)
+#error "RX_LANES must be 1 or 2"
+#endif
+
+#if (RX_LANES == 2) && (HAMMING_R != 4)
+#error "RX_LANES = 2 needs HAMMING_R = 4"
+#endif
+
+#if (RX_LANES == 2) && (RX_CAPTURE_MODE == RX_CAPTURE_STROBE)
+#error "RX_LANES = 2 uses P3.2 (INT0) for lane B, RX_CAPTURE_STROBE is not available"
+#endif
+
+#if (RX_LANES == 2) && RX_AUX_PARITY
+#error "RX_LANES = 2 uses P3.3 for lane B line 15, RX_AUX_PARITY is not available"
+#endif
+
+/* Stateful decode (rx_decoder.c)
+ * rx_decode_step() returns S = H * X^T of the new sample and sets
+ * rx_toggled_line to the column that changed since the previous sample:
+ * 0 = no change, 1..N = that line, RX_TOGGLE_MULTI = several lines.
+ * RX_REPORT_TOGGLES = 1 appends the toggled line to every output record.
+ */
+#define RX_TOGGLE_MULTI     0xFF
+#define RX_REPORT_TOGGLES   0
+
+#if (RX_LANES == 2) && RX_REPORT_TOGGLES
+#error "RX_REPORT_TOGGLES needs RX_LANES = 1"
+#endif
+
+/* Bus resync (User-Editable), see "Bus Resync" in the Tx header.h.
+ * A symbol changes at most one line; the Tx resync uses the two
+ * multi-line changes rx_decode_step() then reports instead of
+ * RX_TOGGLE_MULTI:
+ *   RX_TOGGLE_SKIP:   syndrome unchanged (resync preparation), no symbol
+ *   RX_TOGGLE_RESYNC: the new state is all-zero. The Tx has restarted its
+ *                     symbol split, so the bits of an unfinished character
+ *                     are dropped: "R\r\n" in ASCII, the current frame is
+ *                     closed in binary.
+ * The new reference is the zero state. Other multi-line changes (missed
+ * samples) are decoded as before. */
+#define RX_RESYNC_ENABLE    1
+#define RX_TOGGLE_SKIP      0xFD
+#define RX_TOGGLE_RESYNC    0xFE
+
+/* UART transmit FIFO (rx_output.c / peripherals.c)
+ * The main loop only enqueues; the serial ISR moves one byte to SBUF per TI.
+ * Single producer (main writes txq_head) / single consumer (ISR writes
+ * txq_tail), so no interrupt masking is needed around the indices. */
+#define TXQ_SIZE    32              // Power of two
+#define TXQ_MASK    (TXQ_SIZE - 1)
+
+#if (TXQ_SIZE & TXQ_MASK) != 0
+#error "TXQ_SIZE must be a power of two"
+#endif
+
+/* Output format (User-Editable)
+ * RX_OUTPUT_ASCII:  "<S>\r\n" per decoded symbol (RX_REPORT_TOGGLES applies).
+ * RX_OUTPUT_BINARY: Decoded R-bit symbols are packed MSB-first back into the
+ *                   bytes the Tx split in tx_handler() and sent as frames
+ *                   RX_FRAME_SYNC, <len>, <len bytes> [, <CRC-8>]
+ *                   with len = 1..RX_FRAME_MAX. A frame is closed when full
+ *                   or when the UART goes idle, so frames grow with load.
+ *                   Needs POLL, STROBE or PLL capture (TIMER repeats symbols).
+ *                   Read with Stage1_S_To_Nibble/host_receiver.py.
+ * RX_FRAME_CRC = 1 appends CRC-8 (poly 0x07, init 0x00) over len + payload.
+ */
+#define RX_OUTPUT_ASCII     0
+#define RX_OUTPUT_BINARY    1
+#define RX_OUTPUT_FORMAT    RX_OUTPUT_ASCII
+
+#define RX_FRAME_SYNC       0x7E
+#define RX_FRAME_MAX        8
+#define RX_FRAME_CRC        1
+
+#if (RX_OUTPUT_FORMAT == RX_OUTPUT_BINARY) && (RX_CAPTURE_MODE == RX_CAPTURE_TIMER)
+#error "RX_OUTPUT_BINARY needs RX_CAPTURE_POLL, RX_CAPTURE_STROBE or RX_CAPTURE_PLL"
+#endif
+
+/* Low-power idle (User-Editable)
+ * RX_IDLE_ENABLE = 1: with RX_CAPTURE_TIMER or RX_CAPTURE_STROBE the main
+ * loop waits for the next sample in IDLE (PCON.IDL); Timer0 / INT0 and the
+ * serial ISR wake it. POLL and PLL capture watch the ports from the main
+ * loop and never idle.
+ * RX_WAKE_STATS = 1 measures the wake latency: the sampling ISR stamps
+ * Timer1 (free-running, one core cycle, ~90 ns per count) as it sets
+ * sample_flag, and the main loop takes the difference when it picks the
+ * flag up. Every RX_WAKE_REPORT samples it sends "W <max> <avg>\r\n" in
+ * counts and starts over; the host scripts skip lines that do not start
+ * with a digit. */
+#define RX_IDLE_ENABLE  1
+#define RX_WAKE_STATS   0
+#define RX_WAKE_REPORT  256
+
+#define RX_IDLE_ACTIVE  (RX_IDLE_ENABLE && ((RX_CAPTURE_MODE == RX_CAPTURE_TIMER) || \
+                                            (RX_CAPTURE_MODE == RX_CAPTURE_STROBE)))
+
+#if RX_WAKE_STATS && (RX_CAPTURE_MODE != RX_CAPTURE_TIMER) && (RX_CAPTURE_MODE != RX_CAPTURE_STROBE)
+#error "RX_WAKE_STATS needs RX_CAPTURE_TIMER or RX_CAPTURE_STROBE"
+#endif
+
+#if RX_WAKE_STATS && (RX_OUTPUT_FORMAT == RX_OUTPUT_BINARY)
+#error "RX_WAKE_STATS reports in ASCII lines, use RX_OUTPUT_ASCII"
+#endif
+
+/* Interrupt latency probe (User-Editable)
+ * RX_LATENCY_STATS = 1: Timer2 auto-reloads from 0 (interrupt 5 every
+ * ~5.93 ms). It keeps counting after the overflow, so the count Timer2_ISR
+ * reads is how long the interrupt waited (plus a few counts of vector and
+ * entry). The largest one is isr_latency_max; the main loop sends
+ * "L <max>\r\n" in counts each time it grows. */
+#define RX_LATENCY_STATS    0
+
+#if RX_LATENCY_STATS && (RX_OUTPUT_FORMAT == RX_OUTPUT_BINARY)
+#error "RX_LATENCY_STATS reports in ASCII lines, use RX_OUTPUT_ASCII"
+#endif
+
+// Timer1 timestamp; TH1 re-read against a carry between the byte reads
+#define WAKE_STAMP(dst) do { \
+    uint8_t wake_hi_; \
+    do { \
+        wake_hi_ = TH1; \
+        (dst) = ((uint16_t)wake_hi_ << 8) | TL1; \
+    } while (wake_hi_ != TH1); \
+} while (0)
 
 extern volatile bit sample_flag;
+extern volatile uint8_t idata txq[TXQ_SIZE];
+extern volatile uint8_t txq_head;
+extern volatile uint8_t txq_tail;
+extern volatile bit txq_idle;       // ISR found the queue empty, TI is not pending
+extern uint8_t rx_toggled_line;
+#if (RX_LANES == 2)
+extern uint16_t rx_raw_b;           // Lane B lines from the last read_bus_raw()
+#endif
+#if RX_READ_CHECKED
+extern bit rx_read_error;           // Last read_bus_raw() was rejected
+#endif
+#if RX_WAKE_STATS
+extern volatile uint16_t wake_stamp;    // Timer1 when sample_flag was raised
+#endif
+#if RX_LATENCY_STATS
+extern volatile uint16_t isr_latency_max;   // Timer2_ISR: worst entry delay
+#endif
 
 void Timer3_Init(void);
 void UART_Init(void);
 void GlobalINT(void);
 void Port_Init(void);
 void Timer0_Init(void);
+void Strobe_Init(void);
+void Pll_Init(void);
+bit pll_edge(void);
+void cpu_idle(void);
+void Wake_Stats_Init(void);
+void wake_record(void);
+void Latency_Probe_Init(void);
+void latency_report(void);
+uint16_t read_bus_raw(void);
+void unpack_X_from_raw(uint16_t raw, uint8_t *X);
 void read_X_from_bus(uint8_t *X);
+uint16_t bus_lines_from_raw(uint16_t raw);
+bit aux_parity_ok(uint16_t raw);
+uint8_t get_S_from_lines(uint16_t lines);
+uint8_t get_S_from_raw(uint16_t raw);
+void rx_decode_reset(uint16_t raw);
+uint8_t rx_decode_step(uint16_t raw);
 void get_S_from_X(const uint8_t *X_vector, uint8_t hamming_R, uint8_t *S_output);
 uint8_t bits_to_decimal(const uint8_t *bits, uint8_t length);
 void transmit_decimal_uart(uint8_t value);
+void transmit_decimal_toggle_uart(uint8_t value, uint8_t line);
+void transmit_binary_symbol(uint8_t symbol);
+void transmit_binary_flush(void);
+void transmit_binary_resync(void);
+void transmit_resync_uart(void);
+void transmit_read_error_uart(void);
+void transmit_wake_report(uint16_t max, uint16_t avg);
+void transmit_latency_report(uint16_t max);
 
 #endif
@@ -1,43 +1,186 @@
 /* File: main.c
- * Receiver - Reads 11-bit X from ports, decodes to S, outputs decimal ASCII via UART
+ * Receiver - Reads N-bit X from ports, decodes to S, outputs decimal ASCII via UART
+ * N and the symbol width R follow HAMMING_R in header.h
  */
 #include <aduc841.h>
 #include "header.h"
 
 volatile bit sample_flag = 0;
 
+// POLL / PLL edge detection against the previous snapshot (both lanes)
+#if (RX_LANES == 2)
+#define BUS_CHANGED()   (raw != last_raw || rx_raw_b != last_raw_b)
+#define BUS_KEEP()      do { last_raw = raw; last_raw_b = rx_raw_b; } while (0)
+#else
+#define BUS_CHANGED()   (raw != last_raw)
+#define BUS_KEEP()      (last_raw = raw)
+#endif
+
+// Sample passed the stable-read and aux parity checks (always when
+// neither RX_STABLE_WINDOW nor RX_AUX_PARITY is set)
+#if RX_READ_CHECKED
+#define READ_OK()       (!rx_read_error)
+#else
+#define READ_OK()       1
+#endif
+
 void main(void)
 {
-    uint8_t X[HAMMING_N];
-    uint8_t S[HAMMING_R];
     uint8_t decimal_value;
+    uint16_t raw;
+#if (RX_LANES == 2)
+    uint8_t symbol_b;
+#endif
+#if (RX_CAPTURE_MODE == RX_CAPTURE_POLL) || (RX_CAPTURE_MODE == RX_CAPTURE_PLL)
+    uint16_t last_raw;
+#if (RX_LANES == 2)
+    uint16_t last_raw_b;
+#endif
+#endif
     
     GlobalINT();
     Timer3_Init();
     UART_Init();
     Port_Init();
+#if (RX_CAPTURE_MODE == RX_CAPTURE_TIMER)
     Timer0_Init();  // Periodic sampling timer
+#elif (RX_CAPTURE_MODE == RX_CAPTURE_STROBE)
+    Strobe_Init();  // INT0 from Tx STROBE_PIN
+#elif (RX_CAPTURE_MODE == RX_CAPTURE_PLL)
+    Pll_Init();     // Timer1 timestamps, Timer0 phase-locked sampler
+#endif
+#if RX_WAKE_STATS
+    Wake_Stats_Init();  // Timer1 timestamps for the wake latency
+#endif
+#if RX_LATENCY_STATS
+    Latency_Probe_Init();   // Timer2 measures its own interrupt latency
+#endif
+    
+    raw = read_bus_raw();
+    rx_decode_reset(raw);       // Reference for rx_toggled_line
+#if (RX_CAPTURE_MODE == RX_CAPTURE_POLL) || (RX_CAPTURE_MODE == RX_CAPTURE_PLL)
+    BUS_KEEP();                 // Only changes from the power-up state count
+#endif
     
     while(1)
     {
+#if RX_LATENCY_STATS
+        latency_report();
+#endif
+        
+#if (RX_CAPTURE_MODE == RX_CAPTURE_POLL)
+        // Edge detection: compare against the previous snapshot (an odd
+        // one is a glitch, not a transition)
+        raw = read_bus_raw();
+        if (BUS_CHANGED() && READ_OK())
+        {
+            BUS_KEEP();
+            sample_flag = 1;
+        }
+#elif (RX_CAPTURE_MODE == RX_CAPTURE_PLL)
+        // Transitions only steer the sampler; Timer0 sets sample_flag.
+        // Without a period estimate yet, decode the transition itself.
+        raw = read_bus_raw();
+        if (BUS_CHANGED() && READ_OK())
+        {
+            BUS_KEEP();
+            if (!pll_edge())
+            {
+                sample_flag = 1;
+            }
+        }
+#endif
+        
         if (sample_flag)
         {
-            EA = 0;
+            // Interrupts stay on: Timer0/INT0 keep sampling while the
+            // serial ISR sends earlier results from txq
             sample_flag = 0;
             
-            // Read X from input ports
-            read_X_from_bus(X);
+#if RX_WAKE_STATS
+            wake_record();
+#endif
+            
+            // Read X from input ports (POLL: decode the snapshot that
+            // triggered, so a newer state is picked up on the next pass)
+#if (RX_CAPTURE_MODE == RX_CAPTURE_TIMER) || (RX_CAPTURE_MODE == RX_CAPTURE_STROBE)
+            raw = read_bus_raw();
+#elif (RX_CAPTURE_MODE == RX_CAPTURE_PLL)
+            raw = read_bus_raw();
+            if (READ_OK())
+            {
+                BUS_KEEP();     // A change seen here is not a new transition
+            }
+#endif
+            
+#if RX_READ_CHECKED
+            // Unstable, or lines + aux line stayed odd: drop the sample,
+            // keep the decoder reference at the last good state
+            if (rx_read_error)
+            {
+#if (RX_OUTPUT_FORMAT == RX_OUTPUT_ASCII)
+                transmit_read_error_uart();
+#endif
+                continue;
+            }
+#endif
             
-            // Decode X to S using provided logic
-            get_S_from_X(X, HAMMING_R, S);
+            // Decode the packed snapshot straight to S (XOR fold)
+            decimal_value = rx_decode_step(raw);
+#if (RX_LANES == 2)
+            // Lane B is read in line order: no reordering needed
+            symbol_b = get_S_from_lines(rx_raw_b);
+#endif
             
-            // Convert S bit array to decimal value
-            decimal_value = bits_to_decimal(S, HAMMING_R);
+#if RX_RESYNC_ENABLE
+            // Tx resync markers are not symbols
+            if (rx_toggled_line == RX_TOGGLE_RESYNC)
+            {
+#if (RX_OUTPUT_FORMAT == RX_OUTPUT_BINARY)
+                transmit_binary_resync();
+#else
+                transmit_resync_uart();
+#endif
+                continue;
+            }
+            if (rx_toggled_line == RX_TOGGLE_SKIP)
+            {
+                continue;
+            }
+#endif
             
+#if (RX_OUTPUT_FORMAT == RX_OUTPUT_BINARY)
+            // Pack into the current frame
+            transmit_binary_symbol(decimal_value);
+#if (RX_LANES == 2)
+            transmit_binary_symbol(symbol_b);   // Low nibble of the same byte
+#endif
+#elif RX_REPORT_TOGGLES
+            // Transmit as decimal ASCII with the toggled line
+            transmit_decimal_toggle_uart(decimal_value, rx_toggled_line);
+#else
             // Transmit as decimal ASCII
             transmit_decimal_uart(decimal_value);
-            
-            EA = 1;
+#if (RX_LANES == 2)
+            transmit_decimal_uart(symbol_b);
+#endif
+#endif
+        }
+#if (RX_OUTPUT_FORMAT == RX_OUTPUT_BINARY) || RX_IDLE_ACTIVE
+        else
+        {
+#if (RX_OUTPUT_FORMAT == RX_OUTPUT_BINARY)
+            // Link idle: send what has been collected so far
+            if (txq_idle)
+            {
+                transmit_binary_flush();
+            }
+#endif
+#if RX_IDLE_ACTIVE
+            // Nothing to decode: sleep until Timer0 / INT0 / serial ISR
+            cpu_idle();
+#endif
         }
+#endif
     }
 }
@@ -2,11 +2,16 @@
 #include <aduc841.h>
 #include "header.h"
 
+// Timer 3 baud settings @ 11.0592 MHz, indexed by BAUD_xxx:
+// Baud = 2 * fcore / (2^(DIV-1) * (T3FD + 64)), T3CON = 0x80 | DIV
+static uint8_t code baud_t3con[BAUD_COUNT] = { 0x86, 0x85, 0x84, 0x83, 0x82, 0x81 };
+static uint8_t code baud_t3fd[BAUD_COUNT]  = { 0x08, 0x08, 0x08, 0x20, 0x20, 0x20 };
+
 void Timer3_Init(void)
 {
-    T3CON &= 0xFE;
-    T3CON |= 0x86;
-    T3FD = 0x08;
+    T3CON = 0x00;
+    T3FD = baud_t3fd[UART_BAUD_INDEX];
+    T3CON = baud_t3con[UART_BAUD_INDEX];
 }
 
 void UART_Init(void)
@@ -14,7 +19,33 @@ void UART_Init(void)
     SM0 = 0;
     SM1 = 1;
     REN = 0;  // Transmit only
-    TI = 1;   // Set TI to allow first transmission
+    TI = 0;   // Nothing sent yet; uart_send() kicks the ISR
+    txq_idle = 1;
+    ES = 1;   // Serial ISR drains txq
+}
+
+// Serial ISR: one queued byte per TI, receiver stays off (REN = 0)
+void UART_ISR(void) interrupt 4
+{
+    if (TI)
+    {
+        TI = 0;
+        
+        if (txq_tail != txq_head)
+        {
+            SBUF = txq[txq_tail];
+            txq_tail = (txq_tail + 1) & TXQ_MASK;
+        }
+        else
+        {
+            txq_idle = 1;
+        }
+    }
+    
+    if (RI)
+    {
+        RI = 0;
+    }
 }
 
 void GlobalINT(void)
@@ -27,26 +58,292 @@ void Port_Init(void)
     // Port 2: Input (all bits = 1 for high-impedance input)
     P2 = 0xFF;
     
+#if (HAMMING_R == 4)
     // Port 3: P3.4-P3.7 as inputs
     P3 |= 0xF0;
+    
+    // Port 0: P0.0-P0.2 as inputs (lines 13-15)
+    P0 |= 0x07;
+    
+#if RX_AUX_PARITY
+    P3 |= 0x08;     // P3.3 (aux parity line)
+#endif
+#endif
+    
+#if (RX_LANES == 2)
+    // Lane B: Port 1 powers up as analog inputs, a 0 selects digital input
+    P1 = 0x00;
+    P0 |= 0xF8;     // P0.3-P0.7 (lines 9-13)
+    P3 |= 0x0C;     // P3.2-P3.3 (lines 14-15)
+#endif
 }
 
 void Timer0_Init(void)
 {
-    // Mode 1: 16-bit timer, sample every ~10ms
+    // Mode 1: 16-bit timer, sample every ~0.9ms
     TMOD &= 0xF0;
     TMOD |= 0x01;
     
-    TH0 = 0xD8;  // Reload for ~10ms @ 11.0592MHz
+    TH0 = 0xD8;  // Reload: 10000 core cycles, ~0.9ms @ 11.0592MHz
     TL0 = 0xF0;
     
     ET0 = 1;  // Enable Timer0 interrupt
     TR0 = 1;  // Start timer
 }
 
+#if (RX_CAPTURE_MODE == RX_CAPTURE_PLL)
+// Phase lock state: Timer1 timestamps transitions, Timer0 is the sampler.
+// pll_edge() changes these only while Timer0 is stopped, so the ISR never
+// sees a half-written value.
+static uint16_t pll_last_edge;
+static uint16_t pll_period = 0;         // 0 = no estimate yet
+static uint16_t pll_window_min;
+static uint8_t pll_window_count = 0;
+static uint8_t pll_reload_h;            // Timer0 reload for one period
+static uint8_t pll_reload_l;
+static volatile uint8_t pll_hold = 0;   // Samples left, 0 = sampler stopped
+
+// Timer1: free-running 16-bit timestamp counter, no interrupt.
+// Timer0: one-shot per sample, reloaded by the ISR.
+void Pll_Init(void)
+{
+    TMOD = 0x11;    // Timer0 and Timer1 in mode 1 (16-bit)
+    TH1 = 0;
+    TL1 = 0;
+    TR1 = 1;
+    
+    TR0 = 0;
+    ET0 = 1;
+    pll_window_min = 0xFFFF;
+}
+
+// Transition seen by the main loop. Updates the period estimate and
+// re-phases the sampler to the middle of the new symbol.
+// Returns 1 if the sampler will report this symbol, 0 if the caller must
+// decode it (no estimate yet).
+// 1. Timestamp (TH1 re-read against a carry between the byte reads)
+// 2. Gap since the last transition, used only if the sampler was still
+//    running (so it is at most RX_PLL_HOLD + 1 periods) and plausible
+// 3. Every RX_PLL_WINDOW gaps: T = shortest gap (gaps are multiples of T)
+// 4. Restart Timer0: first sample after T/2, then every T
+// Before the first estimate Timer0 runs once for RX_PLL_MAX_TICKS and
+// only marks the gap as too long (pll_hold = 0).
+bit pll_edge(void)
+{
+    uint8_t hi;
+    uint16_t now;
+    uint16_t gap;
+    uint16_t start;
+    
+    do
+    {
+        hi = TH1;
+        now = ((uint16_t)hi << 8) | TL1;
+    } while (hi != TH1);
+    
+    gap = now - pll_last_edge;
+    pll_last_edge = now;
+    
+    // Stop the sampler first: the ISR reads pll_period and the reload
+    TR0 = 0;
+    TF0 = 0;
+    
+    if (pll_hold != 0 && gap >= RX_PLL_MIN_TICKS && gap <= RX_PLL_MAX_TICKS)
+    {
+        if (gap < pll_window_min)
+        {
+            pll_window_min = gap;
+        }
+        
+        if (++pll_window_count == RX_PLL_WINDOW)
+        {
+            pll_period = pll_window_min;
+            pll_reload_h = (uint8_t)((0 - pll_period) >> 8);
+            pll_reload_l = (uint8_t)(0 - pll_period);
+            pll_window_count = 0;
+            pll_window_min = 0xFFFF;
+        }
+    }
+    
+    // Load half a period and restart
+    start = (pll_period != 0) ? (0 - (pll_period >> 1)) : (0 - RX_PLL_MAX_TICKS);
+    TH0 = (uint8_t)(start >> 8);
+    TL0 = (uint8_t)start;
+    pll_hold = RX_PLL_HOLD;
+    TR0 = 1;
+    
+    return (pll_period != 0);
+}
+
+void Timer0_ISR(void) interrupt 1
+{
+    if (pll_period == 0)
+    {
+        pll_hold = 0;           // Gap too long to measure
+        TR0 = 0;
+        return;
+    }
+    
+    TH0 = pll_reload_h;
+    TL0 = pll_reload_l;
+    sample_flag = 1;
+    
+    if (--pll_hold == 0)
+    {
+        TR0 = 0;                // No transition for RX_PLL_HOLD symbols
+    }
+}
+#else
 void Timer0_ISR(void) interrupt 1
 {
     TH0 = 0xD8;
     TL0 = 0xF0;
+#if RX_WAKE_STATS
+    WAKE_STAMP(wake_stamp);
+#endif
     sample_flag = 1;
 }
+#endif
+
+// INT0 (P3.2) as symbol strobe for RX_CAPTURE_STROBE.
+// Wire to Tx STROBE_PIN: it pulses once per symbol after the latch, so the
+// 74HC595 outputs already show the new state when the ISR runs.
+void Strobe_Init(void)
+{
+    P3 |= 0x04;     // P3.2 as input
+    IT0 = 1;        // Falling-edge triggered
+    IE0 = 0;        // Drop any edge seen before now
+    EX0 = 1;        // Enable INT0 interrupt
+}
+
+void External0_ISR(void) interrupt 0
+{
+#if RX_WAKE_STATS
+    WAKE_STAMP(wake_stamp);
+#endif
+    sample_flag = 1;
+}
+
+#if RX_IDLE_ACTIVE
+// Sleep in IDLE until the next interrupt if no sample is waiting.
+// EA = 0 keeps a sample ISR out between the test and setting IDL. The
+// 8051 runs one more instruction after a write to IE before it takes an
+// interrupt, so with "SETB EA; ORL PCON,#01H" an ISR that came in during
+// the test is still pending at IDL and ends the idle at once.
+void cpu_idle(void)
+{
+    EA = 0;
+    
+    if (!sample_flag)
+    {
+        EA = 1;
+        PCON |= 0x01;   // IDL: CPU stops, timers/UART/interrupts keep running
+    }
+    
+    EA = 1;
+}
+#endif
+
+#if RX_WAKE_STATS
+volatile uint16_t wake_stamp = 0;
+static uint16_t wake_max = 0;
+static unsigned long wake_sum = 0;
+static uint16_t wake_count = 0;
+
+// Timer1: free-running 16-bit timestamp counter, no interrupt
+void Wake_Stats_Init(void)
+{
+    TMOD &= 0x0F;
+    TMOD |= 0x10;   // Timer1 in mode 1 (16-bit)
+    TH1 = 0;
+    TL1 = 0;
+    ET1 = 0;
+    TR1 = 1;
+}
+
+// Main loop, right after taking sample_flag: ISR stamp -> now
+void wake_record(void)
+{
+    uint16_t stamp;
+    uint16_t now;
+    uint16_t latency;
+    
+    // Read twice: the next sample ISR may rewrite the stamp meanwhile
+    do
+    {
+        stamp = wake_stamp;
+    } while (stamp != wake_stamp);
+    
+    WAKE_STAMP(now);
+    latency = now - stamp;
+    
+    if (latency > wake_max)
+    {
+        wake_max = latency;
+    }
+    wake_sum += latency;
+    
+    if (++wake_count == RX_WAKE_REPORT)
+    {
+        transmit_wake_report(wake_max, (uint16_t)(wake_sum / RX_WAKE_REPORT));
+        wake_max = 0;
+        wake_sum = 0;
+        wake_count = 0;
+    }
+}
+#endif
+
+#if RX_LATENCY_STATS
+volatile uint16_t isr_latency_max = 0;
+static uint16_t latency_reported = 0;
+
+// Timer2: 16-bit auto-reload from 0, used only to measure its own latency
+void Latency_Probe_Init(void)
+{
+    T2CON = 0x00;   // Auto-reload, timer, stopped
+    RCAP2H = 0;
+    RCAP2L = 0;
+    TH2 = 0;
+    TL2 = 0;
+    ET2 = 1;
+    TR2 = 1;
+}
+
+void Timer2_ISR(void) interrupt 5
+{
+    uint8_t late_hi;
+    uint16_t late;
+    
+    TF2 = 0;        // Not cleared by hardware
+    
+    // Counts since the overflow (TH2 re-read against a carry)
+    do
+    {
+        late_hi = TH2;
+        late = ((uint16_t)late_hi << 8) | TL2;
+    } while (late_hi != TH2);
+    
+    if (late > isr_latency_max)
+    {
+        isr_latency_max = late;
+    }
+}
+
+// Main loop: send the maximum when it has grown
+void latency_report(void)
+{
+    uint16_t latency;
+    
+    // Read twice: Timer2_ISR may update it between the byte reads
+    do
+    {
+        latency = isr_latency_max;
+    } while (latency != isr_latency_max);
+    
+    if (latency != latency_reported)
+    {
+        latency_reported = latency;
+        transmit_latency_report(latency);
+    }
+}
+#endif